@@ -1,5 +1,7 @@
 #pragma once
 #include <algorithm>
+#include <iostream>
+#include <iterator>
 
 #define InputIterator typename
 #define ForwardIterator typename
@@ -1,5 +1,7 @@
 #pragma once
 #include <vector>
+#include <algorithm>
+#include <cstddef>
 
 template<typename I, typename T, typename Op>
 T add_to_counter(I first, I last, Op op, const T& zero, T carry) {
@@ -57,6 +59,20 @@ public:
             counter.push_back(x);
     }
     
+    void add(T x, std::size_t level) {
+        // x is placed at the given level; every lower level is first folded
+        // into x, in order, so that the counter stays stable
+        if (counter.size() < level)
+            counter.resize(level, zero);
+        T lower = reduce_counter(counter.begin(), counter.begin() + level, op, zero);
+        std::fill(counter.begin(), counter.begin() + level, zero);
+        if (lower != zero)
+            x = op(lower, x);
+        x = add_to_counter(counter.begin() + level, counter.end(), op, zero, x);
+        if (x != zero)
+            counter.push_back(x);
+    }
+    
     T reduce() {
         return reduce_counter(counter.begin(), counter.end(), op, zero);
     }
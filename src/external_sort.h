@@ -0,0 +1,254 @@
+#pragma once
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+#include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#endif
+#include "merge.h"
+#include "temporary_buffer.h"
+
+// runs are read and written in blocks of this many bytes
+const std::size_t EXTERNAL_SORT_BLOCK = std::size_t(1) << 20;
+
+struct external_sort_stats
+{
+    std::size_t records = 0;
+    std::size_t bytes = 0;          // size of the input
+    std::size_t runs = 0;           // sorted runs written by the first pass
+    std::size_t passes = 0;         // passes over the data, including the first
+    std::size_t bytes_read = 0;
+    std::size_t bytes_written = 0;
+    double seconds = 0;
+
+    double mb_per_second() const {
+        return seconds > 0 ? double(bytes) / (1 << 20) / seconds : 0;
+    }
+};
+
+struct file_closer
+{
+    void operator()(std::FILE* f) const { std::fclose(f); }
+};
+
+typedef std::unique_ptr<std::FILE, file_closer> file_ptr;
+
+inline
+file_ptr open_file(const std::string& name, const char* mode) {
+    file_ptr f(std::fopen(name.c_str(), mode));
+    if (!f) throw std::system_error(errno, std::generic_category(), name);
+    // our own blocks are the buffering; stdio would only copy them again
+    std::setvbuf(f.get(), nullptr, _IONBF, 0);
+#if defined(POSIX_FADV_SEQUENTIAL)
+    // let the kernel read ahead aggressively
+    posix_fadvise(fileno(f.get()), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    return f;
+}
+
+template <typename T>
+// requires: T is trivially copyable
+std::size_t read_records(std::FILE* f, T* first, std::size_t n, const std::string& name) {
+    std::size_t k = std::fread(first, sizeof(T), n, f);
+    if (k < n && std::ferror(f)) throw std::system_error(errno, std::generic_category(), name);
+    return k;
+}
+
+template <typename T>
+// requires: T is trivially copyable
+void write_records(std::FILE* f, const T* first, std::size_t n, const std::string& name) {
+    if (std::fwrite(first, sizeof(T), n, f) != n)
+        throw std::system_error(errno, std::generic_category(), name);
+}
+
+template <typename T>
+// requires: T is trivially copyable
+class run_reader
+{
+    // reads a run sequentially, one block at a time
+private:
+    std::string name;
+    file_ptr f;
+    std::vector<T> block;
+    std::size_t position;
+    std::size_t size;
+    std::size_t* bytes;
+
+    void refill() {
+        size = read_records(f.get(), block.data(), block.size(), name);
+        *bytes += size * sizeof(T);
+        position = 0;
+    }
+
+public:
+    run_reader(const std::string& name, std::size_t block_size, std::size_t& bytes) :
+        name{ name }, f{ open_file(name, "rb") }, block(block_size),
+        position{ 0 }, size{ 0 }, bytes{ &bytes } {
+        refill();
+    }
+
+    bool empty() const { return position == size; }
+    const T& top() const { return block[position]; }
+
+    void pop() {
+        if (++position == size) refill();
+    }
+};
+
+template <typename T>
+// requires: T is trivially copyable
+class run_writer
+{
+    // appends to a run, one block at a time
+private:
+    std::string name;
+    file_ptr f;
+    std::vector<T> block;
+    std::size_t size;
+    std::size_t* bytes;
+
+public:
+    run_writer(const std::string& name, std::size_t block_size, std::size_t& bytes) :
+        name{ name }, f{ open_file(name, "wb") }, block(block_size), size{ 0 }, bytes{ &bytes } {}
+
+    void push(const T& x) {
+        block[size] = x;
+        if (++size == block.size()) flush();
+    }
+
+    void flush() {
+        write_records(f.get(), block.data(), size, name);
+        *bytes += size * sizeof(T);
+        size = 0;
+    }
+
+    void close() {
+        flush();
+        if (std::fclose(f.release()) != 0) throw std::system_error(errno, std::generic_category(), name);
+    }
+};
+
+template <typename T, typename R>
+// requires: T is trivially copyable
+// requires: R is StrictWeakOrdering on T
+void merge_runs(const std::vector<std::string>& runs, const std::string& output,
+                std::size_t block_size, R r, external_sort_stats& stats) {
+    // merges the runs with a heap of run indices; among equal records the
+    // one from the earlier run comes first, so the merge is stable
+    std::vector<std::unique_ptr<run_reader<T>>> readers;
+    std::vector<std::size_t> heap;
+    for (const std::string& name : runs) {
+        readers.emplace_back(new run_reader<T>(name, block_size, stats.bytes_read));
+        if (!readers.back()->empty()) heap.push_back(readers.size() - 1);
+    }
+    auto later = [&](std::size_t i, std::size_t j) {
+        const T& x = readers[i]->top();
+        const T& y = readers[j]->top();
+        return r(y, x) || (!r(x, y) && j < i);
+    };
+    std::make_heap(heap.begin(), heap.end(), later);
+    run_writer<T> writer(output, block_size, stats.bytes_written);
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        std::size_t i = heap.back();
+        writer.push(readers[i]->top());
+        readers[i]->pop();
+        if (readers[i]->empty())
+            heap.pop_back();
+        else
+            std::push_heap(heap.begin(), heap.end(), later);
+    }
+    writer.close();
+}
+
+inline
+std::string run_name(const std::string& temp_dir, std::size_t pass, std::size_t i) {
+    return temp_dir + "/run-" + std::to_string(pass) + "-" + std::to_string(i);
+}
+
+template <typename T, typename R>
+// requires: T is trivially copyable
+// requires: R is StrictWeakOrdering on T
+external_sort_stats external_sort(const std::string& input, const std::string& output,
+                                  const std::string& temp_dir, std::size_t memory, R r) {
+    // stable sort of a file of records of type T into another file, using
+    // about memory bytes of RAM and run files in temp_dir.
+    // The first pass sorts chunks with sort_adaptive_n and a buffer of an
+    // eighth of the chunk; every later pass merges as many runs at once as
+    // the memory holds blocks
+    static_assert(std::is_trivially_copyable<T>::value, "records are copied as bytes");
+    typedef std::ptrdiff_t N;
+    auto start = std::chrono::steady_clock::now();
+    external_sort_stats stats;
+    std::size_t block_size = std::max(std::size_t(1), EXTERNAL_SORT_BLOCK / sizeof(T));
+    std::size_t chunk_size = std::max(std::size_t(2), memory / sizeof(T) * 8 / 9);
+    std::size_t blocks = memory / (block_size * sizeof(T));
+    std::size_t fan_in = std::max(std::size_t(2), blocks > 0 ? blocks - 1 : 0);
+
+    std::vector<std::string> runs;
+    {
+        std::vector<T> chunk(chunk_size);
+        temporary_buffer<T> buffer(N(chunk_size / 8));
+        file_ptr in = open_file(input, "rb");
+        if (std::fseek(in.get(), 0, SEEK_END) != 0) throw std::system_error(errno, std::generic_category(), input);
+        stats.bytes = std::size_t(std::ftell(in.get()));
+        if (stats.bytes % sizeof(T))
+            throw std::runtime_error(input + ": size is not a multiple of the record size");
+        std::rewind(in.get());
+        while (true) {
+            std::size_t n = read_records(in.get(), chunk.data(), chunk_size, input);
+            if (!n && !runs.empty()) break;
+            stats.bytes_read += n * sizeof(T);
+            stats.records += n;
+            sort_adaptive_n(chunk.data(), N(n), r, buffer.begin(), std::min(buffer.size(), N(n >> 1)));
+            runs.push_back(run_name(temp_dir, 0, runs.size()));
+            file_ptr out = open_file(runs.back(), "wb");
+            write_records(out.get(), chunk.data(), n, runs.back());
+            if (std::fclose(out.release()) != 0)
+                throw std::system_error(errno, std::generic_category(), runs.back());
+            stats.bytes_written += n * sizeof(T);
+            if (n < chunk_size) break;
+        }
+    }
+    stats.runs = runs.size();
+    stats.passes = 1;
+
+    while (runs.size() > 1) {
+        std::vector<std::string> merged;
+        bool last_pass = runs.size() <= fan_in;
+        for (std::size_t i = 0; i < runs.size(); i += fan_in) {
+            std::vector<std::string> group(runs.begin() + i,
+                                           runs.begin() + std::min(runs.size(), i + fan_in));
+            merged.push_back(last_pass ? output : run_name(temp_dir, stats.passes, merged.size()));
+            merge_runs<T>(group, merged.back(), block_size, r, stats);
+            for (const std::string& name : group) std::remove(name.c_str());
+        }
+        runs.swap(merged);
+        ++stats.passes;
+    }
+    if (runs.front() != output && std::rename(runs.front().c_str(), output.c_str()) != 0) {
+        // temp_dir is on another file system; copy the run instead
+        merge_runs<T>(runs, output, block_size, r, stats);
+        std::remove(runs.front().c_str());
+    }
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+template <typename T>
+// requires: T is trivially copyable and TotallyOrdered
+inline
+external_sort_stats external_sort(const std::string& input, const std::string& output,
+                                  const std::string& temp_dir, std::size_t memory) {
+    return external_sort<T>(input, output, temp_dir, memory, std::less<T>{});
+}
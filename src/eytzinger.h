@@ -0,0 +1,135 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <vector>
+
+// A static search index over a sorted range, stored in Eytzinger (BFS)
+// order: the root at 1 and the children of k at 2k and 2k + 1. A search
+// reads one path from the root down, and the top levels that every search
+// touches share a few cache lines. The descent is a single add per level,
+// with no branch on the comparison, and the 16 or so descendants four
+// levels down sit on one cache line that is prefetched ahead of use
+
+// the size of the blocks the hardware reads from memory
+const std::size_t EYTZINGER_LINE = 64;
+
+template <typename T, typename R = std::less<T>, typename N = std::size_t>
+// requires: T is Regular and DefaultConstructible
+// requires: R is StrictWeakOrdering on T
+// requires: N is an unsigned Integral type that can hold twice the size of the range
+class eytzinger_index
+{
+private:
+    // the descendants of k at 16k to 16k + 15 (for 4 byte elements) fill
+    // one cache line; elements of a line or more prefetch the children
+    static const std::size_t prefetch_stride = EYTZINGER_LINE / sizeof(T) > 2 ? EYTZINGER_LINE / sizeof(T) : 2;
+
+    std::vector<T> storage;
+    T* a;                   // a[1] to a[n], with a on a cache line boundary when possible
+    N n;
+    int height;             // the levels 0 to height - 1 are full
+    R r;
+
+    template <typename I>
+    // requires: I is InputIterator with value type T
+    void fill(I& first, N k) {
+        // an in-order walk of the implicit tree takes the sorted elements in order
+        if (k > n) return;
+        fill(first, 2 * k);
+        a[k] = *first;
+        ++first;
+        fill(first, 2 * k + 1);
+    }
+
+    static int floor_log2(N k) {
+        // precondition: k > 0
+#if defined(__GNUC__)
+        return 63 - __builtin_clzll(static_cast<unsigned long long>(k));
+#else
+        int d = 0;
+        while (k >>= 1) ++d;
+        return d;
+#endif
+    }
+
+    N rank(N k) const {
+        // the in-order position of node k: its position if the last level
+        // were full, less the missing last level nodes that would precede it
+        int d = floor_log2(k);
+        N full = ((2 * (k - (N(1) << d)) + 1) << (height - d)) - 1;
+        N last_level = n - ((N(1) << height) - 1);
+        N before = (full + 1) >> 1;
+        return before > last_level ? full - (before - last_level) : full;
+    }
+
+    void prefetch(N k) const {
+#if defined(__GNUC__)
+        // an address computation, not pointer arithmetic: it may be past the end
+        __builtin_prefetch(reinterpret_cast<const void*>(
+            reinterpret_cast<std::uintptr_t>(a) + std::uintptr_t(k) * prefetch_stride * sizeof(T)));
+#else
+        (void)k;
+#endif
+    }
+
+    N rank_of(N k) const {
+        // the path went right after the last node not less than the value,
+        // and left once after it to the end; cancelling those trailing right
+        // turns and the last left one gives that node, or 0 if there is none
+#if defined(__GNUC__)
+        k >>= __builtin_ctzll(~static_cast<unsigned long long>(k)) + 1;
+#else
+        while (k & 1) k >>= 1;
+        k >>= 1;
+#endif
+        return k ? rank(k) : n;
+    }
+
+public:
+    eytzinger_index() : a{ nullptr }, n{ 0 }, height{ 0 } {}
+
+    template <typename I>
+    // requires: I is InputIterator with value type T
+    eytzinger_index(I first, N n, R r = R{}) : n{ n }, height{ floor_log2(n + 1) }, r{ r } {
+        // precondition: is_sorted_n(first, n, r)
+        const std::size_t slack = EYTZINGER_LINE / sizeof(T);
+        storage.resize(std::size_t(n) + 1 + slack);
+        a = storage.data();
+        // a line boundary is only reachable a whole number of elements
+        // ahead, and only within the slack; otherwise a stays unaligned
+        std::size_t gap = (EYTZINGER_LINE - reinterpret_cast<std::uintptr_t>(a) % EYTZINGER_LINE) % EYTZINGER_LINE;
+        if (gap % sizeof(T) == 0 && gap / sizeof(T) <= slack) a += gap / sizeof(T);
+        fill(first, 1);
+    }
+
+    // a points into storage, which a move leaves where it is
+    eytzinger_index(eytzinger_index&&) = default;
+    eytzinger_index& operator=(eytzinger_index&&) = default;
+    eytzinger_index(const eytzinger_index&) = delete;
+    eytzinger_index& operator=(const eytzinger_index&) = delete;
+
+    N size() const { return n; }
+
+    N lower_bound(const T& x) const {
+        // the position in the sorted range of the first element not less
+        // than x, or size() if there is none
+        N k = 1;
+        while (k <= n) {
+            prefetch(k);
+            k = 2 * k + N(r(a[k], x));
+        }
+        return rank_of(k);
+    }
+
+    N upper_bound(const T& x) const {
+        // the position of the first element greater than x, or size()
+        N k = 1;
+        while (k <= n) {
+            prefetch(k);
+            k = 2 * k + N(!r(x, a[k]));
+        }
+        return rank_of(k);
+    }
+};
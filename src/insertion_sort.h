@@ -1,5 +1,6 @@
 #pragma once
 #include <iterator>
+#include <utility>
 #include "algorithm.h"
 #include "search.h"
 #include "min_element.h"
@@ -19,9 +20,9 @@ void rotate_right_by_1(I first, I last, std::bidirectional_iterator_tag) {
 	typedef typename std::iterator_traits<I>::value_type T;
 	I prev_last = last;
 	--prev_last;
-	T x = *prev_last;
-	std::copy_backward(first, prev_last, last);
-	*first = x;
+	T x = std::move(*prev_last);
+	std::move_backward(first, prev_last, last);
+	*first = std::move(x);
 }
 
 template <typename I>
@@ -89,12 +90,12 @@ template <typename I, typename R>
 I linear_insert(I first, I current, R r) {
 	// precondition: is_sorted(first, current, r) && current is a valid iterator
 	typedef typename std::iterator_traits<I>::value_type T;
-	T value = *current;
+	T value = std::move(*current);
 	while (first != current && r(value, *predecessor(current))) {
-		*current = *predecessor(current);
+		*current = std::move(*predecessor(current));
 		--current;
 	}
-	*current = value;
+	*current = std::move(value);
 	return current;
 }
 
@@ -107,12 +108,12 @@ I linear_insert_with_sentinel(I first, I current, R r) {
 	//               first != current &&
 	//               !r(*current, *first)
 	typedef typename std::iterator_traits<I>::value_type T;
-	T value = *current;
+	T value = std::move(*current);
 	while (r(value, *predecessor(current))) {
-		*current = *predecessor(current);
+		*current = std::move(*predecessor(current));
 		--current;
 	}
-	*current = value;
+	*current = std::move(value);
 	return current;
 }
 
@@ -151,7 +152,7 @@ template <typename I, typename R>
 // requires: R is WeakStrictOrdering on the value type of I
 void selection_sort(I first, I last, R r) {
 	while (first != last) {
-		std::swap(*first, *min_element(first, last, r)); // not stable!
+		std::swap(*first, *::min_element(first, last, r)); // not stable!
 		++first;
 	}
 }
@@ -161,7 +162,7 @@ template <typename I, typename R>
 // requires: R is WeakStrictOrdering on the value type of I
 void stable_selection_sort(I first, I last, R r) {
 	while (first != last) {
-		rotate_right_by_1(first, ++min_element(first, last, r));
+		rotate_right_by_1(first, successor(::min_element(first, last, r)));
 		++first;
 	}
 }
@@ -188,7 +189,7 @@ void insertion_sort(I first, I last, R r) {
 	I current = first;
 	++current;
 	if (current == last) return;
-	rotate_right_by_1(first, ++min_element(first, last, r));
+	rotate_right_by_1(first, successor(::min_element(first, last, r)));
 	insertion_sort_suffix(current, last, r);	
 }
 
@@ -200,7 +201,7 @@ void insertion_sort_unstable(I first, I last, R r) {
 	I current = first;
 	++current;
 	if (current == last) return;
-	std::swap(*first, *min_element(first, last, r));
+	std::swap(*first, *::min_element(first, last, r));
 	insertion_sort_suffix(current, last, r);
 }
 
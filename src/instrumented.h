@@ -1,5 +1,6 @@
 #pragma once
 #include <utility>
+#include <cstddef>
 
 struct instrumented_base {
     enum operations {
@@ -0,0 +1,233 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include "search.h"
+
+// Interpolation search guesses where a value lies from the values at the
+// ends of the range still to be searched. On uniformly distributed keys a
+// guess in a range of m elements is off by about sqrt(m), so each guess is
+// followed by a probe sqrt(m) beyond it, which brackets the value in a
+// range of sqrt(m): about 2 log log n probes against the log n of
+// bisection. On skewed keys the guesses can be arbitrarily bad, so the
+// first step that neither brackets the value nor cuts the range to a
+// fraction of what it was hands the rest of the search to binary search,
+// which keeps the worst case within a few probes of binary search
+
+// ranges this short are finished by binary search
+const std::size_t INTERPOLATION_SEARCH_CUTOFF = 8;
+
+// a guess must leave at most this fraction of the range
+const std::size_t INTERPOLATION_SEARCH_SHRINK = 8;
+
+template <typename P>
+// requires: P is UnaryPredicate
+class counting_predicate
+{
+    // counts the elements a search looks at
+private:
+    P pred;
+    std::size_t* count;
+public:
+    counting_predicate(const P& pred, std::size_t& count) : pred{ pred }, count{ &count } {}
+    template <typename T>
+    bool operator()(const T& x) {
+        ++*count;
+        return pred(x);
+    }
+};
+
+template <typename I, typename N, typename P>
+// requires: I is RandomAccessIterator
+// requires: N is Integral
+// requires: P is UnaryPredicate on the value type of I
+I bisect_within_n(I first, N n, N lo, N hi, P pred, std::size_t& probes) {
+    // precondition: is_partitioned_n(first, n, pred)
+    // precondition: the partition point is in [lo, hi]
+    // partition_point_n over the whole range, reading only elements in
+    // [lo, hi): the others are known to be before or after the point. The
+    // first few elements it reads are the same for every search, so they
+    // stay in cache, which a bisection of [lo, hi) alone would not
+    N f(0);
+    while (n) {
+        N half = n >> 1;
+        N middle = f + half;
+        bool before;
+        if (middle < lo) {
+            before = true;
+        } else if (middle >= hi) {
+            before = false;
+        } else {
+            ++probes;
+            before = pred(first[middle]);
+        }
+        if (before) {
+            f = middle + N(1);
+            n -= half + N(1);
+        } else {
+            n = half;
+        }
+    }
+    return first + f;
+}
+
+template <typename T>
+// requires: T is Integral
+inline
+double interpolation_fraction(const T& a, const T& left, const T& right, std::true_type) {
+    // precondition: left <= a <= right && left < right
+    // the differences are exact in the unsigned type; converting the keys
+    // to double first would make distinct keys above 2^53 equal
+    typedef typename std::make_unsigned<T>::type U;
+    return double(U(a) - U(left)) / double(U(right) - U(left));
+}
+
+template <typename T>
+// requires: T is a floating point type
+inline
+double interpolation_fraction(const T& a, const T& left, const T& right, std::false_type) {
+    // precondition: left <= a <= right && left < right
+    return (double(a) - double(left)) / (double(right) - double(left));
+}
+
+template <typename T>
+// requires: T is arithmetic
+inline
+double interpolation_fraction(const T& a, const T& left, const T& right) {
+    // precondition: left <= a <= right && left < right
+    // where a lies between left and right, in [0, 1]. Rounding can push
+    // the quotient past 1, and a difference of floating point keys can
+    // overflow to make it NaN; both are clamped
+    double f = interpolation_fraction(a, left, right, typename std::is_integral<T>::type{});
+    if (!(f >= 0.0)) return 0.0;
+    return f < 1.0 ? f : 1.0;
+}
+
+template <typename I, typename N, typename P>
+// requires: I is RandomAccessIterator with an arithmetic value type
+// requires: N is Integral
+// requires: P is UnaryPredicate on the value type of I that holds for the
+//           elements less than a (or not greater than a) and no others
+I interpolation_partition_point_n(I first, N n, const typename std::iterator_traits<I>::value_type& a,
+                                  P pred, std::size_t& probes) {
+    // precondition: is_sorted_n(first, n) and no element is a NaN
+    // the partition point is in [lo, hi]; left is the last element known
+    // to satisfy pred, right the first known not to
+    typedef typename std::iterator_traits<I>::value_type T;
+    static_assert(std::is_arithmetic<T>::value, "interpolation needs numeric keys");
+    if (!n) return first;
+    ++probes;
+    if (!pred(first[0])) return first;
+    ++probes;
+    if (pred(first[n - N(1)])) return first + n;
+    N lo(1);
+    N hi(n - N(1));
+    T left = first[0];
+    T right = first[n - N(1)];
+    while (hi - lo > N(INTERPOLATION_SEARCH_CUTOFF)) {
+        N m = hi - lo;
+        // left < right, since pred holds for left and not for right
+        N p = lo + N(interpolation_fraction(a, left, right) * double(m));
+        if (p < lo) p = lo;
+        if (p >= hi) p = hi - N(1);
+        N d = N(std::sqrt(double(m)));
+        ++probes;
+        if (pred(first[p])) {
+            left = first[p];
+            lo = p + N(1);
+            if (hi - lo > d) {
+                p = lo + d;
+                ++probes;
+                if (pred(first[p])) {
+                    left = first[p];
+                    lo = p + N(1);
+                } else {
+                    right = first[p];
+                    hi = p;
+                }
+            }
+        } else {
+            right = first[p];
+            hi = p;
+            if (hi - lo > d) {
+                p = hi - d - N(1);
+                ++probes;
+                if (pred(first[p])) {
+                    left = first[p];
+                    lo = p + N(1);
+                } else {
+                    right = first[p];
+                    hi = p;
+                }
+            }
+        }
+        if (hi - lo > std::max(d, m / N(INTERPOLATION_SEARCH_SHRINK)))
+            return bisect_within_n(first, n, lo, hi, pred, probes);
+    }
+    return partition_point_n(first + lo, hi - lo, counting_predicate<P>(pred, probes));
+}
+
+template <typename I, typename N>
+// requires: I is RandomAccessIterator with an arithmetic value type
+// requires: N is Integral
+inline
+I interpolation_lower_bound_n(I first, N n, const typename std::iterator_traits<I>::value_type& a,
+                              std::size_t& probes) {
+    // precondition: is_sorted_n(first, n) and no element is a NaN
+    // lower_bound_n, adding the number of elements looked at to probes
+    typedef typename std::iterator_traits<I>::value_type T;
+    typedef std::less<T> R;
+    return interpolation_partition_point_n(first, n, a, lower_bound_predicate<R, T>{ R{}, a }, probes);
+}
+
+template <typename I, typename N>
+// requires: I is RandomAccessIterator with an arithmetic value type
+// requires: N is Integral
+inline
+I interpolation_lower_bound_n(I first, N n, const typename std::iterator_traits<I>::value_type& a) {
+    // precondition: is_sorted_n(first, n) and no element is a NaN
+    std::size_t probes = 0;
+    return interpolation_lower_bound_n(first, n, a, probes);
+}
+
+template <typename I, typename N>
+// requires: I is RandomAccessIterator with an arithmetic value type
+// requires: N is Integral
+inline
+I interpolation_upper_bound_n(I first, N n, const typename std::iterator_traits<I>::value_type& a,
+                              std::size_t& probes) {
+    // precondition: is_sorted_n(first, n) and no element is a NaN
+    // upper_bound_n, adding the number of elements looked at to probes
+    typedef typename std::iterator_traits<I>::value_type T;
+    typedef std::less<T> R;
+    return interpolation_partition_point_n(first, n, a, upper_bound_predicate<R, T>{ R{}, a }, probes);
+}
+
+template <typename I, typename N>
+// requires: I is RandomAccessIterator with an arithmetic value type
+// requires: N is Integral
+inline
+I interpolation_upper_bound_n(I first, N n, const typename std::iterator_traits<I>::value_type& a) {
+    // precondition: is_sorted_n(first, n) and no element is a NaN
+    std::size_t probes = 0;
+    return interpolation_upper_bound_n(first, n, a, probes);
+}
+
+template <typename I>
+// requires: I is RandomAccessIterator with an arithmetic value type
+inline
+I interpolation_lower_bound(I first, I last, const typename std::iterator_traits<I>::value_type& a) {
+    // precondition: is_sorted(first, last) and no element is a NaN
+    return interpolation_lower_bound_n(first, last - first, a);
+}
+
+template <typename I>
+// requires: I is RandomAccessIterator with an arithmetic value type
+inline
+I interpolation_upper_bound(I first, I last, const typename std::iterator_traits<I>::value_type& a) {
+    // precondition: is_sorted(first, last) and no element is a NaN
+    return interpolation_upper_bound_n(first, last - first, a);
+}
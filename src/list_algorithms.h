@@ -1,5 +1,18 @@
 #pragma once
+#include <cstddef>
+#include <iterator>
+#include <utility>
+#include <vector>
+#include "algorithm.h"
 #include "binary_counter.h"
+#include "search.h"
+
+template <typename I>
+// requires I is Linked Iterator
+inline
+void prefetch(const I&) {
+    // iterators that can hint the memory system provide their own prefetch
+}
 
 template <typename I>
 // requires I is Linked Iterator
@@ -26,6 +39,81 @@ I merged_linked_simple(I first1, I last1, I first2, I last2, Compare cmp) {
     return reverse_linked(result, last1, first1 == last1 ? first2 : first1);
 }
 
+const std::size_t MERGE_LINKED_GALLOP = 7;
+
+template <typename I, typename P>
+// requires I is Linked Iterator
+// requires P is UnaryPredicate on ValueType(I)
+I find_last_linked(I first, I last, P pred) {
+    // precondition: first != last && pred(*first) && is_partitioned(first, last, pred)
+    // postcondition: pred(*result) && (successor(result) == last || !pred(*successor(result)))
+    std::size_t n = MERGE_LINKED_GALLOP;
+    while (n--) {
+        I next = first;
+        if (++next == last) return first;
+        prefetch(successor(next));
+        if (!pred(*next)) return first;
+        first = next;
+    }
+    // the run is long: gallop, comparing only at distances 1, 2, 4, ...
+    std::size_t step = 1;
+    while (true) {
+        I probe = first;
+        std::size_t k = 0;
+        while (k < step && ++probe != last) ++k;
+        if (k == step && pred(*probe)) {
+            first = probe;
+            step <<= 1;
+            continue;
+        }
+        if (k < step) ++k;
+        // invariant: pred(*first) && the node k steps after first is last or fails pred
+        while (k > 1) {
+            std::size_t half = k >> 1;
+            I middle = first;
+            for (std::size_t i = 0; i < half; ++i) ++middle;
+            if (pred(*middle)) {
+                first = middle;
+                k -= half;
+            } else {
+                k = half;
+            }
+        }
+        return first;
+    }
+}
+
+template <typename I, typename Compare>
+// requires I is Linked Iterator
+I merge_linked(I first1, I last1, I first2, I last2, Compare cmp) {
+    // builds the result front to back: nodes are relinked only where the
+    // output switches between the inputs, and the remainder of the input
+    // that runs out last is spliced in with a single set_successor
+    typedef typename std::iterator_traits<I>::value_type T;
+    if (first1 == last1) return first2;
+    if (first2 == last2) return first1;
+    prefetch(successor(first1));
+    prefetch(successor(first2));
+    bool second = cmp(*first2, *first1);
+    I result = second ? first2 : first1;
+    while (true) {
+        if (second) {
+            I tail = find_last_linked(first2, last2, lower_bound_predicate<Compare, T>{ cmp, *first1 });
+            first2 = tail;
+            ++first2;
+            set_successor(tail, first1);
+            if (first2 == last2) return result;
+        } else {
+            I tail = find_last_linked(first1, last1, upper_bound_predicate<Compare, T>{ cmp, *first2 });
+            first1 = tail;
+            ++first1;
+            set_successor(tail, first2);
+            if (first1 == last1) return result;
+        }
+        second = !second;
+    }
+}
+
 template <typename I, typename Compare>
 // requires I is Linked Iterator
 struct mergesort_linked_operation
@@ -34,7 +122,7 @@ struct mergesort_linked_operation
     I nil;
     Compare cmp;
     mergesort_linked_operation(I nil, const Compare& cmp) : nil{ nil }, cmp{ cmp } {}
-    I operator()(I x, I y) { return merged_linked_simple(x, nil, y, nil, cmp); }
+    I operator()(I x, I y) { return merge_linked(x, nil, y, nil, cmp); }
 };
 
 template <typename I, typename Compare>
@@ -50,10 +138,147 @@ I mergesort_linked(I first, I last, Compare cmp) {
     return counter.reduce();
 }
 
+template <typename I, typename Compare>
+// requires I is Linked Iterator
+I mergesort_linked_natural(I first, I last, Compare cmp) {
+    // ascending runs are kept, strictly descending runs are reversed,
+    // and each run enters the counter at the level matching its length
+    mergesort_linked_operation<I, Compare> op{ last, cmp };
+    binary_counter<mergesort_linked_operation<I, Compare>> counter{ op, last };
+    while (first != last) {
+        I run_first = first;
+        I run_last = first++;
+        std::size_t n = 1;
+        bool descending = first != last && cmp(*first, *run_last);
+        if (first != last) {
+            run_last = first++;
+            ++n;
+        }
+        while (first != last && cmp(*first, *run_last) == descending) {
+            run_last = first++;
+            ++n;
+        }
+        if (descending)
+            run_first = reverse_linked(run_first, first, last);
+        else
+            set_successor(run_last, last);
+        std::size_t level = 0;
+        while (n >>= 1) ++level;
+        counter.add(run_first, level);
+    }
+    return counter.reduce();
+}
+
+template <typename I, typename Compare>
+// requires I is Linked Iterator
+class loser_tree_linked
+{
+    // leaves are the heads of the lists, nodes 1 .. k-1 hold the loser of
+    // each match and node 0 the overall winner; ties go to the lower list
+    std::vector<I> heads;
+    std::vector<std::size_t> tree;
+    I nil;
+    Compare cmp;
+
+    bool beats(std::size_t x, std::size_t y) {
+        if (heads[y] == nil) return true;
+        if (heads[x] == nil) return false;
+        return x < y ? !cmp(*heads[y], *heads[x]) : cmp(*heads[x], *heads[y]);
+    }
+
+public:
+    template <typename J>
+    // requires J is InputIterator with value type I
+    loser_tree_linked(J first, J last, I nil, const Compare& cmp) :
+        heads(first, last),
+        tree(heads.size()),
+        nil{ nil },
+        cmp{ cmp } {
+        std::size_t k = heads.size();
+        if (!k) return;
+        std::vector<std::size_t> winner(2 * k);
+        for (std::size_t i = 0; i < k; ++i) winner[k + i] = i;
+        for (std::size_t i = k - 1; i > 0; --i) {
+            std::size_t x = winner[2 * i];
+            std::size_t y = winner[2 * i + 1];
+            if (beats(x, y)) {
+                tree[i] = y;
+                winner[i] = x;
+            } else {
+                tree[i] = x;
+                winner[i] = y;
+            }
+        }
+        tree[0] = winner[1];
+    }
+
+    bool empty() const {
+        return heads.empty() || heads[tree[0]] == nil;
+    }
+
+    std::size_t winner() const {
+        return tree[0];
+    }
+
+    I top() const {
+        return heads[tree[0]];
+    }
+
+    I pop() {
+        // precondition: !empty()
+        std::size_t x = tree[0];
+        I result = heads[x];
+        ++heads[x];
+        for (std::size_t i = (x + heads.size()) >> 1; i > 0; i >>= 1) {
+            if (beats(tree[i], x)) std::swap(tree[i], x);
+        }
+        tree[0] = x;
+        return result;
+    }
+};
+
+template <typename J, typename I, typename Compare>
+// requires J is InputIterator with value type I
+// requires I is Linked Iterator
+I merge_linked_k(J first, J last, I nil, Compare cmp) {
+    // precondition: every list in [first, last) is sorted and ends in nil
+    loser_tree_linked<I, Compare> tree(first, last, nil, cmp);
+    if (tree.empty()) return nil;
+    std::size_t previous = tree.winner();
+    I result = tree.pop();
+    I tail = result;
+    while (!tree.empty()) {
+        if (tree.winner() != previous) {
+            previous = tree.winner();
+            set_successor(tail, tree.top());
+        }
+        tail = tree.pop();
+    }
+    return result;
+}
+
+template<typename I1, typename N, typename I2>
+// requires I1 is InputIterator
+// requires N is Integral
+// requires I2 is Singly Linked List Iterator
+void push_front_n(I2& tail, I1 first, N n) {
+    if (n == N(0)) return;
+    push_front(tail, *first);
+    ++first;
+    --n;
+    I2 current = tail;
+    while (n != N(0)) {
+        push_back(current, *first);
+        ++first;
+        --n;
+        ++current;
+    }
+}
+
 template<typename I1, typename I2>
 // requires I1 is InputIterator
-// requires I2 is Linked List Iterator
-I2 generate_list(I1 first, I1 last, I2 tail) {
+// requires I2 is Singly Linked List Iterator
+I2 generate_list(I1 first, I1 last, I2 tail, std::input_iterator_tag) {
     if (first == last) return tail;
     push_front(tail, *first);
     ++first;
@@ -64,4 +289,20 @@ I2 generate_list(I1 first, I1 last, I2 tail) {
         ++tail;
     }
     return front;
-}
\ No newline at end of file
+}
+
+template<typename I1, typename I2>
+// requires I1 is ForwardIterator
+// requires I2 is Singly Linked List Iterator
+I2 generate_list(I1 first, I1 last, I2 tail, std::forward_iterator_tag) {
+    push_front_n(tail, first, std::distance(first, last));
+    return tail;
+}
+
+template<typename I1, typename I2>
+// requires I1 is InputIterator
+// requires I2 is Singly Linked List Iterator
+inline
+I2 generate_list(I1 first, I1 last, I2 tail) {
+    return generate_list(first, last, tail, typename std::iterator_traits<I1>::iterator_category{});
+}
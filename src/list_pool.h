@@ -1,6 +1,9 @@
 #pragma once
 #include <vector>
 #include <cstddef>
+#include <iterator>
+#include <algorithm>
+#include "thread_pool.h"
 
 template<typename T, typename N = std::size_t>
 // Requires T is semi-regular
@@ -11,6 +14,10 @@ public:
     typedef N list_type;
     typedef T value_type;
 
+    // appends of at least this many nodes from a random access range are
+    // filled by the threads of a thread_pool, when one is given
+    static const std::size_t PARALLEL_FILL_CUTOFF = std::size_t(1) << 20;
+
 private:
     struct node_t
     {
@@ -63,6 +70,12 @@ public:
         return node(x).next;
     }
 
+    void prefetch(list_type x) const {
+#if defined(__GNUC__)
+        if (!is_empty(x)) __builtin_prefetch(&node(x));
+#endif
+    }
+
     list_type free(list_type x) {
         list_type cdr = next(x);
         next(x) = free_list;  
@@ -81,11 +94,95 @@ public:
         return list;
     }
 
+    template <typename I, typename M>
+    // requires I is InputIterator with value type T
+    // requires M is Integral
+    list_type allocate_n(I first, M n, list_type tail) {
+        // builds the list of the n values starting at first in front of tail
+        return allocate_n(first, n, tail, nullptr);
+    }
+
+    template <typename I, typename M>
+    // requires I is InputIterator with value type T
+    // requires M is Integral
+    list_type allocate_n(I first, M n, list_type tail, thread_pool& threads) {
+        // the same, with a large random access range filled by threads
+        return allocate_n(first, n, tail, &threads);
+    }
+
+private:
+    template <typename I, typename M>
+    // requires I is InputIterator with value type T
+    // requires M is Integral
+    list_type allocate_n(I first, M n, list_type tail, thread_pool* threads) {
+        // builds the list of the n values starting at first in front of tail:
+        // free nodes are reused first, the rest are appended to the pool in
+        // one pass, so a fresh list is contiguous
+        list_type list = free_list;
+        list_type last = empty();
+        while (n != M(0) && !is_empty(free_list)) {
+            value(free_list) = *first;
+            ++first;
+            --n;
+            last = free_list;
+            free_list = next(free_list);
+        }
+        if (n == M(0)) {
+            if (!is_empty(last)) next(last) = tail;
+            return is_empty(last) ? tail : list;
+        }
+        list_type fresh = list_type(pool.size() + 1);
+        append_n(first, n, tail, threads, typename std::iterator_traits<I>::iterator_category{});
+        if (is_empty(last)) return fresh;
+        next(last) = fresh;
+        return list;
+    }
+
+    void reserve_more(std::size_t n) {
+        // room for n more nodes; the capacity at least doubles when it
+        // grows, as with push_back, so many small appends stay linear
+        std::size_t needed = pool.size() + n;
+        if (needed > pool.capacity()) pool.reserve(std::max(needed, 2 * pool.capacity()));
+    }
+
+    template <typename I, typename M>
+    // requires I is InputIterator
+    void append_n(I first, M n, list_type tail, thread_pool*, std::input_iterator_tag) {
+        reserve_more(std::size_t(n));
+        while (n != M(0)) {
+            pool.push_back(node_t{ *first, list_type(pool.size() + 2) });
+            ++first;
+            --n;
+        }
+        pool.back().next = tail;
+    }
+
+    template <typename I, typename M>
+    // requires I is RandomAccessIterator
+    void append_n(I first, M n, list_type tail, thread_pool* threads, std::random_access_iterator_tag) {
+        if (!threads || threads->size() < 2 || std::size_t(n) < PARALLEL_FILL_CUTOFF) {
+            append_n(first, n, tail, threads, std::input_iterator_tag{});
+            return;
+        }
+        std::size_t base = pool.size();
+        reserve_more(std::size_t(n));
+        pool.resize(base + std::size_t(n));
+        std::size_t chunks = 4 * threads->size();
+        parallel_for(*threads, std::size_t(0), chunks, [&](std::size_t c) {
+            std::size_t j = (c + 1) * std::size_t(n) / chunks;
+            for (std::size_t k = c * std::size_t(n) / chunks; k < j; ++k) {
+                pool[base + k].value = first[k];
+                pool[base + k].next = list_type(base + k + 2);
+            }
+        });
+        pool.back().next = tail;
+    }
 
+public:
     struct iterator
     {
         typedef typename list_pool::value_type value_type;
-        typedef typename list_pool::list_type differnece_type;
+        typedef typename list_pool::list_type difference_type;
         typedef std::forward_iterator_tag iterator_category;
         typedef value_type& reference;
         typedef value_type* pointer;
@@ -135,6 +232,11 @@ public:
             x.pool->next(x.node) = y.node;
         }
 
+        friend
+        void prefetch(iterator x) {
+            x.pool->prefetch(x.node);
+        }
+
         // extend the interface to Singly Linked List Iterator
 
         friend
@@ -142,6 +244,12 @@ public:
             x.node = x.pool->allocate(value, x.node);
         }
 
+        template <typename I, typename M>
+        friend
+        void push_front_n(iterator& x, I first, M n) {
+            x.node = x.pool->allocate_n(first, n, x.node);
+        }
+
         friend
         void push_back(iterator& x, const T& value) {
             typename list_pool::list_type tmp = x.pool->allocate(value, x.pool->next(x.node));
@@ -1,86 +1,285 @@
 #pragma once
 #include <iterator>
 #include <algorithm>
-#include <vector>
 #include <functional>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include "merge_inplace.h"
+#include "insertion_sort.h"
+#include "move.h"
+#include "simd_sort.h"
+#include "temporary_buffer.h"
+
+template <typename R>
+// requires: R is StrictWeakOrdering
+class converse
+{
+private:
+    R r;
+public:
+    converse(const R& r) : r{ r } {}
+    template <typename T>
+    bool operator()(const T& x, const T& y) { return r(y, x); }
+};
+
+// a side that wins this many times in a row switches the merge to galloping
+const std::size_t MERGE_GALLOP = 7;
+
+template <typename B, typename I, typename R>
+// requires: B is RandomAccessIterator
+// requires: I is ForwardIterator with the value type of B
+// requires: R is StrictWeakOrdering on the value type of I
+I merge_from_buffer(B first0, B last0, I first1, I last1, I result, R r, std::false_type) {
+    // As in TimSort, once one side keeps winning, runs are found by galloping
+    // and block-moved, and the threshold adapts to how well galloping pays
+    typedef typename std::iterator_traits<I>::value_type T;
+    typedef typename std::iterator_traits<B>::difference_type N0;
+    typedef typename std::iterator_traits<I>::difference_type N1;
+    N0 n0 = last0 - first0;
+    N1 n1 = std::distance(first1, last1);
+    std::size_t min_gallop = MERGE_GALLOP;
+    while (n0) {
+        if (!n1) return std::move(first0, last0, result);
+        std::size_t count0 = 0;
+        std::size_t count1 = 0;
+        do {
+            if (r(*first1, *first0)) {
+                *result = std::move(*first1);
+                ++first1;
+                --n1;
+                ++count1;
+                count0 = 0;
+            } else {
+                *result = std::move(*first0);
+                ++first0;
+                --n0;
+                ++count0;
+                count1 = 0;
+            }
+            ++result;
+        } while (n0 && n1 && count0 < min_gallop && count1 < min_gallop);
+        while (n0 && n1) {
+            B p0 = partition_point_gallop_n(first0, n0, upper_bound_predicate<R, T>{ r, *first1 });
+            count0 = std::size_t(p0 - first0);
+            result = std::move(first0, p0, result);
+            first0 = p0;
+            n0 -= N0(count0);
+            if (!n0) break;
+            I p1 = partition_point_gallop_n(first1, n1, lower_bound_predicate<R, T>{ r, *first0 });
+            count1 = std::size_t(std::distance(first1, p1));
+            result = std::move(first1, p1, result);
+            first1 = p1;
+            n1 -= N1(count1);
+            if (count0 < MERGE_GALLOP && count1 < MERGE_GALLOP) {
+                ++min_gallop;
+                break;
+            }
+            if (min_gallop > 1) --min_gallop;
+        }
+    }
+    return last1;
+}
+
+// value types up to this size are merged without branching on comparisons
+const std::size_t MERGE_BRANCHLESS_SIZE = 16;
+
+template <typename I, typename R>
+// requires: I is Iterator
+// requires: R is StrictWeakOrdering on the value type of I
+struct is_branchless_mergeable
+{
+    // comparing and copying is cheap enough that a mispredicted branch
+    // costs more than always doing both
+    typedef typename std::iterator_traits<I>::value_type T;
+    static const bool value = is_memmovable<I>::value &&
+                              sizeof(T) <= MERGE_BRANCHLESS_SIZE &&
+                              std::is_same<R, std::less<T>>::value;
+    typedef std::integral_constant<bool, value> type;
+};
+
+template <typename T>
+// requires: T is TotallyOrdered and trivially copyable
+T* merge_from_buffer_branchless(T* first0, T* last0, T* first1, T* last1, T* result) {
+    // precondition: result + (last0 - first0) == first1
+    // the comparison selects a source pointer and advances one side by
+    // adding its outcome, which compiles to conditional moves
+    while (first0 != last0 && first1 != last1) {
+        bool take1 = *first1 < *first0;
+        *result = *(take1 ? first1 : first0);
+        first1 += take1;
+        first0 += !take1;
+        ++result;
+    }
+    std::ptrdiff_t n0 = last0 - first0;
+    if (n0) std::memmove(result, first0, n0 * sizeof(T));
+    return last1;
+}
+
+template <typename T>
+// requires: T is TotallyOrdered and trivially copyable
+T* merge_from_buffer_backward_branchless(T* first0, T* last0, T* first1, T* last1, T* result) {
+    // precondition: result - (last1 - first1) == last0
+    // the mirror image of merge_from_buffer_branchless: merges [first1, last1)
+    // and the buffer [first0, last0) from their ends into [.., result)
+    while (first0 != last0 && first1 != last1) {
+        bool take1 = *(last0 - 1) < *(last1 - 1);
+        *--result = *(take1 ? last1 - 1 : last0 - 1);
+        last1 -= take1;
+        last0 -= !take1;
+    }
+    std::ptrdiff_t n0 = last0 - first0;
+    if (n0) std::memmove(result - n0, first0, n0 * sizeof(T));
+    return first1;
+}
+
+template <typename B, typename I, typename R>
+// requires: B is a pointer to the value type of I
+// requires: I is ContiguousIterator
+// requires: R is StrictWeakOrdering on the value type of I
+I merge_from_buffer(B first0, B last0, I first1, I last1, I result, R r, std::true_type) {
+    typedef typename std::iterator_traits<I>::value_type T;
+    if (first0 == last0) return last1;
+    // result is in front of first1 and dereferenceable while the buffer is not empty
+    B out = std::addressof(*result);
+    B f1 = out + (last0 - first0);
+    B l1 = f1 + (last1 - first1);
+    if (f1 != l1) {
+        // the branchless loop cannot gallop, so the elements that are already
+        // in order at both ends are found by search; presorted input costs
+        // O(log n) comparisons and a block move
+        B p0 = partition_point_gallop_n(first0, last0 - first0, upper_bound_predicate<R, T>{ r, *f1 });
+        std::memmove(out, first0, (p0 - first0) * sizeof(T));
+        out += p0 - first0;
+        first0 = p0;
+        if (first0 != last0)
+            l1 = partition_point_n(f1, l1 - f1, lower_bound_predicate<R, T>{ r, *(last0 - 1) });
+    }
+    merge_from_buffer_branchless(first0, last0, f1, l1, out);
+    return last1;
+}
+
+template <typename B, typename I, typename R>
+// requires: B is RandomAccessIterator
+// requires: I is ForwardIterator with the value type of B
+// requires: R is StrictWeakOrdering on the value type of I
+inline
+I merge_from_buffer(B first0, B last0, I first1, I last1, I result, R r) {
+    // precondition: result + (last0 - first0) + (last1 - first1) is last1,
+    //               so whatever remains of [first1, last1) is already in place
+    // elements are moved; equal elements are taken from the buffer first
+    return merge_from_buffer(first0, last0, first1, last1, result, r,
+                             typename is_branchless_mergeable<I, R>::type{});
+}
 
 template <typename I, typename R, typename B>
 // requires: I is ForwardIterator
-// requires: O is OutputIterator
-// requires: R is StrictWeakOrdering
-void merge_with_buffer(I first1, I middle, I last2, R r, B buffer) {
-    B buffer_last = std::copy(first, middle, buffer);
-    std::merge(buffer, buffer_last, middle, last, first, r);
+// requires: B is a pointer to the value type of I
+// requires: R is StrictWeakOrdering on the value type of I
+void merge_with_buffer(I first, I middle, I last, R r, B buffer) {
+    // precondition: the buffer is uninitialized storage for at least
+    //               std::distance(first, middle) elements
+    B buffer_last = ::uninitialized_move(first, middle, buffer);
+    destroy_guard<typename std::iterator_traits<B>::value_type> guard(buffer, buffer_last);
+    merge_from_buffer(buffer, buffer_last, middle, last, first, r);
 }
 
-template <typename I, typename N, typename R>
+template <typename I, typename R, typename B>
+// requires: I is BidirectionalIterator
+// requires: B is a pointer to the value type of I
+// requires: R is StrictWeakOrdering on the value type of I
+void merge_with_buffer_backward(I first, I middle, I last, R r, B buffer, std::false_type) {
+    typedef std::reverse_iterator<I> RI;
+    typedef std::reverse_iterator<B> RB;
+    B buffer_last = ::uninitialized_move(middle, last, buffer);
+    destroy_guard<typename std::iterator_traits<B>::value_type> guard(buffer, buffer_last);
+    // merging the reversed ranges with the converse ordering and the right
+    // half in the buffer keeps equal elements in their original order
+    merge_from_buffer(RB(buffer_last), RB(buffer), RI(middle), RI(first), RI(last), converse<R>(r));
+}
+
+template <typename I, typename R, typename B>
+// requires: I is ContiguousIterator
+// requires: B is a pointer to the value type of I
+// requires: R is StrictWeakOrdering on the value type of I
+void merge_with_buffer_backward(I first, I middle, I last, R r, B buffer, std::true_type) {
+    typedef typename std::iterator_traits<I>::value_type T;
+    if (first == middle || middle == last) return;
+    B buffer_last = ::uninitialized_move(middle, last, buffer);
+    B l1 = std::addressof(*middle);
+    B f1 = l1 - (middle - first);
+    B out = l1 + (last - middle);
+    // as in merge_from_buffer, the ends that are already in order are found by search
+    B p0 = partition_point_n(buffer, buffer_last - buffer, lower_bound_predicate<R, T>{ r, *(l1 - 1) });
+    out -= buffer_last - p0;
+    std::memmove(out, p0, (buffer_last - p0) * sizeof(T));
+    buffer_last = p0;
+    if (buffer != buffer_last)
+        f1 = partition_point_n(f1, l1 - f1, upper_bound_predicate<R, T>{ r, *buffer });
+    merge_from_buffer_backward_branchless(buffer, buffer_last, f1, l1, out);
+}
+
+template <typename I, typename R, typename B>
+// requires: I is BidirectionalIterator
+// requires: B is a pointer to the value type of I
+// requires: R is StrictWeakOrdering on the value type of I
+inline
+void merge_with_buffer_backward(I first, I middle, I last, R r, B buffer) {
+    // precondition: the buffer is uninitialized storage for at least
+    //               std::distance(middle, last) elements
+    merge_with_buffer_backward(first, middle, last, r, buffer,
+                               typename is_branchless_mergeable<I, R>::type{});
+}
+
+template <typename I, typename N, typename R, typename B>
 // requires: I is ForwardIterator
 // requires: N is Integral
 // requires: R is WeakStrictOrdering on the value type of I
-inline
-void merge_inplace_left_subproblem(I  f0,   N  n0,
-                                   I  f1,   N  n1,
-                                   I& f0_0, N& n0_0,
-                                   I& f0_1, N& n0_1,
-                                   I& f1_0, N& n1_0,
-                                   I& f1_1, N& n1_1,
-                                   R r) {
-    // precondition: std::distance(f0, f1) == n0
-    // precondition: is_sorted_n(f0, n0, r) and is_sorted_n(f1, n1, r)
-    f0_0 = f0;
-    n0_0 = n0 >> 1;
-    f0_1 = f0;
-    std::advance(f0_1, n0_0);
-    f1_1 = lower_bound_n(f1, n1, *f0_1, r);
-    f1_0 = std::rotate(f0_1, f1, f1_1);
-    n0_1 = std::distance(f0_1, f1_0);
-    ++f1_0;
-    n1_0 = (n0 - n0_0) - 1;
-    n1_1 = n1 - n0_1;
+bool merge_n_with_buffer(I f0, N n0, I f1, N n1, R r, B buffer, N buffer_size, std::forward_iterator_tag) {
+    if (buffer_size < n0) return false;
+    I last = f1;
+    std::advance(last, n1);
+    merge_with_buffer(f0, f1, last, r, buffer);
+    return true;
 }
 
-template <typename I, typename N, typename R>
+template <typename I, typename N, typename R, typename B>
+// requires: I is BidirectionalIterator
+// requires: N is Integral
+// requires: R is WeakStrictOrdering on the value type of I
+bool merge_n_with_buffer(I f0, N n0, I f1, N n1, R r, B buffer, N buffer_size, std::bidirectional_iterator_tag) {
+    if (n1 < n0 && n1 <= buffer_size) {
+        I last = f1;
+        std::advance(last, n1);
+        merge_with_buffer_backward(f0, f1, last, r, buffer);
+        return true;
+    }
+    return merge_n_with_buffer(f0, n0, f1, n1, r, buffer, buffer_size, std::forward_iterator_tag{});
+}
+
+template <typename I, typename N, typename R, typename B>
 // requires: I is ForwardIterator
 // requires: N is Integral
 // requires: R is WeakStrictOrdering on the value type of I
 inline
-void merge_inplace_right_subproblem(I  f0,   N  n0,
-                                    I  f1,   N  n1,
-                                    I& f0_0, N& n0_0,
-                                    I& f0_1, N& n0_1,
-                                    I& f1_0, N& n1_0,
-                                    I& f1_1, N& n1_1,
-                                    R r) {
-    // precondition: std::distance(f0, f1) == n0
-    // precondition: is_sorted_n(f0, n0, r) and is_sorted_n(f1, n1, r)
-    f0_0 = f0;
-    n0_1 = n1 >> 1;
-    f1_1 = f1;
-    std::advance(f1_1, n0_1);
-    f0_1 = upper_bound_n(f0, n0, *f1_1, r);
-    ++f1_1;
-    f1_0 = std::rotate(f0_1, f1, f1_1);
-    n0_0 = std::distance(f0_0, f0_1);
-    n1_0 = n0 - n0_0;
-    n1_1 = (n1 - n0_1) - 1;
+bool merge_n_with_buffer(I f0, N n0, I f1, N n1, R r, B buffer, N buffer_size) {
+    // merges with the buffer if the smaller usable half fits into it
+    return merge_n_with_buffer(f0, n0, f1, n1, r, buffer, buffer_size,
+                               typename std::iterator_traits<I>::iterator_category{});
 }
 
-
-template <typename I, typename N, typename R, typename B>
+template <typename I, typename N, typename R, typename B, typename Search>
 // requires: I is ForwardIterator
 // requires: N is Integral
 // requires: R is WeakStrictOrdering on the value type of I
-void merge_adaptive_n(I f0, N n0, I f1, N n1, R r, B buffer, N buffer_size) {
+// requires: Search finds bounds like binary_searcher
+void merge_adaptive_n(I f0, N n0, I f1, N n1, R r, B buffer, N buffer_size, Search search) {
     // precondition: std::distance(f0, f1) == n0
     // precondition is_sorted_n(f0, n0, r) && is_sorted_n(f1, n1, r)
     if (!n0 || !n1) return;
 
-    if (n0 <= buffer_size) {
-        I last = f0;
-        std::advance(last, n1);
-        merge_with_buffer(f0, f1, last, r, buffer);
-        return;
-    }
+    if (merge_n_with_buffer(f0, n0, f1, n1, r, buffer, buffer_size)) return;
 
     I f0_0, f0_1, f1_0, f1_1;
     N n0_0, n0_1, n1_0, n1_1;
@@ -91,7 +290,7 @@ void merge_adaptive_n(I f0, N n0, I f1, N n1, R r, B buffer, N buffer_size) {
             f0_1, n0_1,
             f1_0, n1_0,
             f1_1, n1_1,
-            r);
+            r, buffered_rotator<B, N>(buffer, buffer_size), search);
     else
         merge_inplace_right_subproblem(f0, n0,
             f1, n1,
@@ -99,18 +298,30 @@ void merge_adaptive_n(I f0, N n0, I f1, N n1, R r, B buffer, N buffer_size) {
             f0_1, n0_1,
             f1_0, n1_0,
             f1_1, n1_1,
-            r);
+            r, buffered_rotator<B, N>(buffer, buffer_size), search);
 
-    merge_adaptive_n(f0_0, n0_0, f0_1, n0_1, r, buffer, buffer_size);
-    merge_adaptive_n(f1_0, n1_0, f1_1, n1_1, r, buffer, buffer_size);
+    merge_adaptive_n(f0_0, n0_0, f0_1, n0_1, r, buffer, buffer_size, search);
+    merge_adaptive_n(f1_0, n1_0, f1_1, n1_1, r, buffer, buffer_size, search);
+}
+
+template <typename I, typename N, typename R, typename B>
+// requires: I is ForwardIterator
+// requires: N is Integral
+// requires: R is WeakStrictOrdering on the value type of I
+inline
+void merge_adaptive_n(I f0, N n0, I f1, N n1, R r, B buffer, N buffer_size) {
+    // precondition: std::distance(f0, f1) == n0
+    // precondition is_sorted_n(f0, n0, r) && is_sorted_n(f1, n1, r)
+    merge_adaptive_n(f0, n0, f1, n1, r, buffer, buffer_size, binary_searcher{});
 }
 
 template <typename I, typename N, typename R, typename B>
 // requires: I is ForwardIterator
-// requires: O is OutputIterator
 // requires: N is Integral
 // requires: R is WeakStrictOrdering on the value type of I
 I sort_inplace_n_with_buffer(I first, N n, R r, B buffer) {
+    // precondition: the buffer holds at least n / 2 elements
+    if (n <= N(SIMD_SORT_CUTOFF) && sort_small_n(first, n, r)) return std::next(first, n);
     if (!n) return first;
     N half = n >> 1;
     if (!half) return ++first;
@@ -120,39 +331,88 @@ I sort_inplace_n_with_buffer(I first, N n, R r, B buffer) {
     return last;
 }
 
-template <typename I>
+template <typename I, typename R>
 // requires: I is ForwardIterator
-void sort_inplace_with_buffer(I first, I last) {
+// requires: R is WeakStrictOrdering on the value type of I
+void sort_inplace_with_buffer(I first, I last, R r) {
     typedef typename std::iterator_traits<I>::value_type T;
     typedef typename std::iterator_traits<I>::difference_type N;
     N n = std::distance(first, last);
-    std::vector<T> buffer(n >> 1);
-    sort_inplace_n_with_buffer(first, size, std::less<T>{}, buffer);
+    temporary_buffer<T> buffer(n >> 1);
+    sort_inplace_n_with_buffer(first, n, r, buffer.begin());
 }
 
-const size_t INSERTION_SORT_CUTOFF = 16;
+template <typename I>
+// requires: I is ForwardIterator
+inline
+void sort_inplace_with_buffer(I first, I last) {
+    typedef typename std::iterator_traits<I>::value_type T;
+    sort_inplace_with_buffer(first, last, std::less<T>{});
+}
+
+const std::size_t INSERTION_SORT_CUTOFF = 16;
+
+template <typename I, typename N, typename R>
+// requires: I is ForwardIterator
+// requires: N is Integral
+// requires: R is WeakStrictOrdering on the value type of I
+inline
+I sort_almost_sorted_n(I first, N n, R r, std::forward_iterator_tag) {
+    return binary_insertion_sort_n(first, n, r);
+}
+
+template <typename I, typename N, typename R>
+// requires: I is BidirectionalIterator
+// requires: N is Integral
+// requires: R is WeakStrictOrdering on the value type of I
+inline
+I sort_almost_sorted_n(I first, N n, R r, std::bidirectional_iterator_tag) {
+    return linear_insertion_sort_n(first, n, r);
+}
+
+template <typename I, typename N, typename R>
+// requires: I is ForwardIterator
+// requires: N is Integral
+// requires: R is WeakStrictOrdering on the value type of I
+inline
+I sort_almost_sorted_n(I first, N n, R r) {
+    return sort_almost_sorted_n(first, n, r, typename std::iterator_traits<I>::iterator_category{});
+}
 
 template <typename I, typename N, typename R, typename B>
 // requires: I is ForwardIterator
 // requires: N is Integral
 // requires: R is WeakStrictOrdering on the value type of I
 I sort_adaptive_n(I first, N n, R r, B buffer, N buffer_size) {
+    if (n <= N(SIMD_SORT_CUTOFF) && sort_small_n(first, n, r)) return std::next(first, n);
     if (!n) return first;
-    if (n < INSERT_SOFT_CUTOFF) return sort_almost_sorted_n(first, n, r);
+    if (n < N(INSERTION_SORT_CUTOFF)) return sort_almost_sorted_n(first, n, r);
     N half = n >> 1;
-    if (!half) return ++first;
     I middle = sort_adaptive_n(first, half, r, buffer, buffer_size);
     I last = sort_adaptive_n(middle, n - half, r, buffer, buffer_size);
     merge_adaptive_n(first, half, middle, n - half, r, buffer, buffer_size);
     return last;
 }
 
+template <typename I, typename R>
+// requires: I is ForwardIterator
+// requires: R is WeakStrictOrdering on the value type of I
+void sort_adaptive(I first, I last, R r, typename std::iterator_traits<I>::difference_type buffer_size) {
+    // stable; uses a buffer of min(buffer_size, n / 2) elements, merging
+    // without one when buffer_size is 0
+    typedef typename std::iterator_traits<I>::value_type T;
+    typedef typename std::iterator_traits<I>::difference_type N;
+    N n = std::distance(first, last);
+    buffer_size = std::max(N(0), std::min(buffer_size, N(n >> 1)));
+    temporary_buffer<T> buffer(buffer_size);
+    sort_adaptive_n(first, n, r, buffer.begin(), buffer_size);
+}
+
 template <typename I>
 // requires: I is ForwardIterator
 void sort_inplace_with_buffer2(I first, I last) {
     typedef typename std::iterator_traits<I>::value_type T;
     typedef typename std::iterator_traits<I>::difference_type N;
     N n = std::distance(first, last);
-    std::vector<T> buffer(n >> 3);
-    sort_adaptive_n(first, size, std::less<T>{}, buffer, buffer.size());
-}
\ No newline at end of file
+    sort_adaptive(first, last, std::less<T>{}, n >> 3);
+}
@@ -4,11 +4,15 @@
 #include <iterator>
 #include <functional>
 #include "search.h"
+#include "rotate.h"
+#include "simd_sort.h"
 
-template <typename I, typename N, typename R>
+template <typename I, typename N, typename R, typename Rotate, typename Search>
 // requires: I is ForwardIterator
 // requires: N is Integral
 // requires: R is WeakStrictOrdering on the value type of I
+// requires: Rotate rotates a range as ::rotate does
+// requires: Search finds bounds like binary_searcher
 inline
 void merge_inplace_left_subproblem(I  f0,   N  n0,
                                    I  f1,   N  n1,
@@ -16,25 +20,27 @@ void merge_inplace_left_subproblem(I  f0,   N  n0,
                                    I& f0_1, N& n0_1,
                                    I& f1_0, N& n1_0,
                                    I& f1_1, N& n1_1,
-                                   R r) {
+                                   R r, Rotate rotate, Search search) {
     // precondition: std::distance(f0, f1) == n0
     // precondition: is_sorted_n(f0, n0, r) and is_sorted_n(f1, n1, r)
     f0_0 = f0;
     n0_0 = n0 >> 1;
     f0_1 = f0;
     std::advance(f0_1, n0_0);
-    f1_1 = lower_bound_n(f1, n1, *f0_1, r);
-    f1_0 = std::rotate(f0_1, f1, f1_1);
+    f1_1 = search.lower_bound_n(f1, n1, *f0_1, r);
+    f1_0 = rotate(f0_1, f1, f1_1);
     n0_1 = std::distance(f0_1, f1_0);
     ++f1_0;
     n1_0 = (n0 - n0_0) - 1;
     n1_1 = n1 - n0_1;
 }
 
-template <typename I, typename N, typename R>
+template <typename I, typename N, typename R, typename Rotate, typename Search>
 // requires: I is ForwardIterator
 // requires: N is Integral
 // requires: R is WeakStrictOrdering on the value type of I
+// requires: Rotate rotates a range as ::rotate does
+// requires: Search finds bounds like binary_searcher
 inline
 void merge_inplace_right_subproblem(I  f0,   N  n0,
                                     I  f1,   N  n1,
@@ -42,27 +48,94 @@ void merge_inplace_right_subproblem(I  f0,   N  n0,
                                     I& f0_1, N& n0_1,
                                     I& f1_0, N& n1_0,
                                     I& f1_1, N& n1_1,
-                                    R r) {
+                                    R r, Rotate rotate, Search search) {
     // precondition: std::distance(f0, f1) == n0
     // precondition: is_sorted_n(f0, n0, r) and is_sorted_n(f1, n1, r)
     f0_0 = f0;
     n0_1 = n1 >> 1;
     f1_1 = f1;
     std::advance(f1_1, n0_1);
-    f0_1 = upper_bound_n(f0, n0, *f1_1, r);
+    f0_1 = search.upper_bound_n(f0, n0, *f1_1, r);
     ++f1_1;
-    f1_0 = std::rotate(f0_1, f1, f1_1);
+    f1_0 = rotate(f0_1, f1, f1_1);
     n0_0 = std::distance(f0_0, f0_1);
     n1_0 = n0 - n0_0;
     n1_1 = (n1 - n0_1) - 1;
 }
 
+template <typename I, typename N, typename R, typename Rotate>
+// requires: I is ForwardIterator
+// requires: N is Integral
+// requires: R is WeakStrictOrdering on the value type of I
+// requires: Rotate rotates a range as ::rotate does
+inline
+void merge_inplace_left_subproblem(I  f0,   N  n0,
+                                   I  f1,   N  n1,
+                                   I& f0_0, N& n0_0,
+                                   I& f0_1, N& n0_1,
+                                   I& f1_0, N& n1_0,
+                                   I& f1_1, N& n1_1,
+                                   R r, Rotate rotate) {
+    merge_inplace_left_subproblem(f0, n0, f1, n1, f0_0, n0_0, f0_1, n0_1,
+                                  f1_0, n1_0, f1_1, n1_1, r, rotate, binary_searcher{});
+}
+
+template <typename I, typename N, typename R, typename Rotate>
+// requires: I is ForwardIterator
+// requires: N is Integral
+// requires: R is WeakStrictOrdering on the value type of I
+// requires: Rotate rotates a range as ::rotate does
+inline
+void merge_inplace_right_subproblem(I  f0,   N  n0,
+                                    I  f1,   N  n1,
+                                    I& f0_0, N& n0_0,
+                                    I& f0_1, N& n0_1,
+                                    I& f1_0, N& n1_0,
+                                    I& f1_1, N& n1_1,
+                                    R r, Rotate rotate) {
+    merge_inplace_right_subproblem(f0, n0, f1, n1, f0_0, n0_0, f0_1, n0_1,
+                                   f1_0, n1_0, f1_1, n1_1, r, rotate, binary_searcher{});
+}
 
 template <typename I, typename N, typename R>
 // requires: I is ForwardIterator
 // requires: N is Integral
 // requires: R is WeakStrictOrdering on the value type of I
-void merge_inplace_n(I f0, N n0, I f1, N n1, R r) {
+inline
+void merge_inplace_left_subproblem(I  f0,   N  n0,
+                                   I  f1,   N  n1,
+                                   I& f0_0, N& n0_0,
+                                   I& f0_1, N& n0_1,
+                                   I& f1_0, N& n1_0,
+                                   I& f1_1, N& n1_1,
+                                   R r) {
+    merge_inplace_left_subproblem(f0, n0, f1, n1, f0_0, n0_0, f0_1, n0_1,
+                                  f1_0, n1_0, f1_1, n1_1, r, rotator{});
+}
+
+template <typename I, typename N, typename R>
+// requires: I is ForwardIterator
+// requires: N is Integral
+// requires: R is WeakStrictOrdering on the value type of I
+inline
+void merge_inplace_right_subproblem(I  f0,   N  n0,
+                                    I  f1,   N  n1,
+                                    I& f0_0, N& n0_0,
+                                    I& f0_1, N& n0_1,
+                                    I& f1_0, N& n1_0,
+                                    I& f1_1, N& n1_1,
+                                    R r) {
+    merge_inplace_right_subproblem(f0, n0, f1, n1, f0_0, n0_0, f0_1, n0_1,
+                                   f1_0, n1_0, f1_1, n1_1, r, rotator{});
+}
+
+
+template <typename I, typename N, typename R, typename Search>
+// requires: I is ForwardIterator
+// requires: N is Integral
+// requires: R is WeakStrictOrdering on the value type of I
+// requires: Search finds bounds like binary_searcher
+void merge_inplace_n(I f0, N n0, I f1, N n1, R r, Search search) {
     // precondition: std::distance(f0, f1) == n0
     // precondition is_sorted_n(f0, n0, r) && is_sorted_n(f1, n1, r)
     if (!n0 || !n1) return;
@@ -75,7 +148,7 @@ void merge_inplace_n(I f0, N n0, I f1, N n1, R r) {
             f0_1, n0_1,
             f1_0, n1_0,
             f1_1, n1_1,
-            r);
+            r, rotator{}, search);
     else
         merge_inplace_right_subproblem(f0, n0,
             f1, n1,
@@ -83,9 +156,20 @@ void merge_inplace_n(I f0, N n0, I f1, N n1, R r) {
             f0_1, n0_1,
             f1_0, n1_0,
             f1_1, n1_1,
-            r);
-    merge_inplace_n(f0_0, n0_0, f0_1, n0_1, r);
-    merge_inplace_n(f1_0, n1_0, f1_1, n1_1, r);
+            r, rotator{}, search);
+    merge_inplace_n(f0_0, n0_0, f0_1, n0_1, r, search);
+    merge_inplace_n(f1_0, n1_0, f1_1, n1_1, r, search);
+}
+
+template <typename I, typename N, typename R>
+// requires: I is ForwardIterator
+// requires: N is Integral
+// requires: R is WeakStrictOrdering on the value type of I
+inline
+void merge_inplace_n(I f0, N n0, I f1, N n1, R r) {
+    // precondition: std::distance(f0, f1) == n0
+    // precondition is_sorted_n(f0, n0, r) && is_sorted_n(f1, n1, r)
+    merge_inplace_n(f0, n0, f1, n1, r, binary_searcher{});
 }
 
 template <typename I, typename N, typename R>
@@ -93,6 +177,7 @@ template <typename I, typename N, typename R>
 // requires: N is Integral
 // requires: R is WeakStrictOrdering on the value type of I
 I sort_inplace_n(I first, N n, R r) {
+    if (n <= N(SIMD_SORT_CUTOFF) && sort_small_n(first, n, r)) return std::next(first, n);
     if (!n) return first;
     N half = n >> 1;
     if (!half) return ++first;
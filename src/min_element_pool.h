@@ -1,4 +1,6 @@
 #pragma once
+#include <algorithm>
+#include <cstddef>
 #include "list_pool.h"
 
 template<typename T, typename N = std::size_t>
@@ -26,4 +28,40 @@ inline
 list_type_t<T, N>
 min_element_pool(const list_pool<T, N>& pool, list_type_t<T, N> list) {
     return ::min_element_pool(pool, list, std::less<T>{});
-}
\ No newline at end of file
+}
+
+const std::size_t MIN_ELEMENT_POOL_LANES = 8;
+
+template<typename Compare, typename T, typename N, typename I, typename O>
+// requires I is InputIterator with value type list_type_t<T, N>
+// requires O is OutputIterator with value type list_type_t<T, N>
+O min_element_pool(const list_pool<T, N>& pool, I first, I last, O result, Compare cmp) {
+    // walks up to MIN_ELEMENT_POOL_LANES independent lists in lock-step, so
+    // that their cache misses overlap instead of being paid one after another
+    list_type_t<T, N> list[MIN_ELEMENT_POOL_LANES];
+    list_type_t<T, N> min_el[MIN_ELEMENT_POOL_LANES];
+    while (first != last) {
+        std::size_t lanes = 0;
+        while (lanes < MIN_ELEMENT_POOL_LANES && first != last) {
+            min_el[lanes] = *first;
+            list[lanes] = pool.is_empty(*first) ? *first : pool.next(*first);
+            pool.prefetch(list[lanes]);
+            ++lanes;
+            ++first;
+        }
+        std::size_t active = lanes;
+        while (active) {
+            active = 0;
+            for (std::size_t i = 0; i < lanes; ++i) {
+                if (pool.is_empty(list[i])) continue;
+                ++active;
+                if (cmp(pool.value(list[i]), pool.value(min_el[i])))
+                    min_el[i] = list[i];
+                list[i] = pool.next(list[i]);
+                pool.prefetch(list[i]);
+            }
+        }
+        result = std::copy(min_el, min_el + lanes, result);
+    }
+    return result;
+}
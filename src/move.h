@@ -0,0 +1,86 @@
+#pragma once
+#include <iterator>
+#include <memory>
+#include <new>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+template <typename I>
+// requires I is an Iterator with an object value type
+struct is_contiguous_iterator
+{
+    typedef typename std::iterator_traits<I>::value_type T;
+    static const bool value = std::is_pointer<I>::value ||
+        (!std::is_same<T, bool>::value &&
+         (std::is_same<I, typename std::vector<T>::iterator>::value ||
+          std::is_same<I, typename std::vector<T>::const_iterator>::value));
+};
+
+template <typename I>
+// requires I is an Iterator with an object value type
+struct is_memmovable
+{
+    // the elements of I can be moved as raw bytes
+    typedef typename std::iterator_traits<I>::value_type T;
+    static const bool value = is_contiguous_iterator<I>::value &&
+                              std::is_trivially_copyable<T>::value;
+    typedef std::integral_constant<bool, value> type;
+};
+
+template <typename T>
+inline
+void destroy(T* first, T* last) {
+    if (std::is_trivially_destructible<T>::value) return;
+    while (first != last) {
+        first->~T();
+        ++first;
+    }
+}
+
+template <typename T>
+// destroys the elements of [first, *last) when it goes out of scope
+class destroy_guard
+{
+private:
+    T* first;
+    T* const* last;
+public:
+    destroy_guard(T* first, T* const& last) : first{ first }, last{ &last } {}
+    ~destroy_guard() { ::destroy(first, *last); }
+    destroy_guard(const destroy_guard&) = delete;
+    destroy_guard& operator=(const destroy_guard&) = delete;
+};
+
+template <typename I, typename T>
+// requires I is InputIterator with value type T
+T* uninitialized_move(I first, I last, T* result, std::false_type) {
+    T* current = result;
+    try {
+        while (first != last) {
+            ::new (static_cast<void*>(current)) T(std::move(*first));
+            ++first;
+            ++current;
+        }
+    } catch (...) {
+        ::destroy(result, current);
+        throw;
+    }
+    return current;
+}
+
+template <typename I, typename T>
+// requires I is ContiguousIterator with trivially copyable value type T
+T* uninitialized_move(I first, I last, T* result, std::true_type) {
+    std::ptrdiff_t n = last - first;
+    if (n) std::memmove(result, std::addressof(*first), n * sizeof(T));
+    return result + n;
+}
+
+template <typename I, typename T>
+// requires I is InputIterator with value type T
+inline
+T* uninitialized_move(I first, I last, T* result) {
+    // precondition: [result, result + distance(first, last)) is uninitialized storage
+    return ::uninitialized_move(first, last, result, typename is_memmovable<I>::type{});
+}
@@ -0,0 +1,348 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include "insertion_sort.h"
+#include "reverse.h"
+#include "sort_two.h"
+
+// Pattern-defeating quicksort (Orson Peters): introsort with ninther
+// pivots, block partitioning, a check for runs that are already sorted
+// and heapsort when partitions keep coming out unbalanced. Not stable.
+
+// partitions smaller than this are finished by insertion sort
+const std::size_t PDQSORT_INSERTION_CUTOFF = 24;
+
+// partitions larger than this take the pivot as a median of medians
+const std::size_t PDQSORT_NINTHER_THRESHOLD = 128;
+
+// a partition that looks sorted is checked by an insertion sort that gives
+// up after moving elements this far in total
+const std::size_t PDQSORT_PARTIAL_INSERTION_LIMIT = 8;
+
+// the block partition classifies this many elements on each side at a time
+const std::size_t PDQSORT_BLOCK = 64;
+
+template <typename I, typename R>
+// requires: I is RandomAccessIterator
+// requires: R is StrictWeakOrdering on the value type of I
+struct is_branchless_partitionable
+{
+    // comparing is cheap and cannot have side effects, so classifying
+    // every element costs less than mispredicting half of the branches
+    typedef typename std::iterator_traits<I>::value_type T;
+    static const bool value = std::is_arithmetic<T>::value &&
+        (std::is_same<R, std::less<T>>::value || std::is_same<R, std::greater<T>>::value);
+    typedef std::integral_constant<bool, value> type;
+};
+
+template <typename I, typename R>
+// requires: I is RandomAccessIterator
+// requires: R is StrictWeakOrdering on the value type of I
+inline
+void sort_three(I a, I b, I c, R r) {
+    sort_two(*a, *b, r);
+    sort_two(*b, *c, r);
+    sort_two(*a, *b, r);
+}
+
+template <typename I, typename R>
+// requires: I is RandomAccessIterator
+// requires: R is StrictWeakOrdering on the value type of I
+bool partial_insertion_sort(I first, I last, R r) {
+    // insertion sorts [first, last) unless that takes more than
+    // PDQSORT_PARTIAL_INSERTION_LIMIT moves; returns whether it finished
+    if (first == last) return true;
+    std::size_t moved = 0;
+    for (I current = first + 1; current != last; ++current) {
+        moved += std::size_t(current - linear_insert(first, current, r));
+        if (moved > PDQSORT_PARTIAL_INSERTION_LIMIT) return false;
+    }
+    return true;
+}
+
+template <typename I, typename R>
+// requires: I is RandomAccessIterator
+// requires: R is StrictWeakOrdering on the value type of I
+std::pair<I, bool> partition_right(I first, I last, R r, std::false_type) {
+    // precondition: *first is the pivot and a median of three, so an
+    //               element not less than it exists in (first, last)
+    // puts the elements less than the pivot before it and the rest after,
+    // and returns the position of the pivot and whether no element moved
+    typedef typename std::iterator_traits<I>::value_type T;
+    T pivot(std::move(*first));
+    I f = first;
+    I l = last;
+    while (r(*++f, pivot));
+    if (f - 1 == first)
+        while (f < l && !r(*--l, pivot));
+    else
+        while (!r(*--l, pivot));
+    bool already_partitioned = f >= l;
+    while (f < l) {
+        std::iter_swap(f, l);
+        while (r(*++f, pivot));
+        while (!r(*--l, pivot));
+    }
+    I pivot_position = f - 1;
+    *first = std::move(*pivot_position);
+    *pivot_position = std::move(pivot);
+    return std::make_pair(pivot_position, already_partitioned);
+}
+
+template <typename I>
+// requires: I is RandomAccessIterator
+void swap_offsets(I first, I last, const unsigned char* offsets_l, const unsigned char* offsets_r,
+                  std::size_t n, bool use_swaps) {
+    // exchanges first + offsets_l[i] with last - offsets_r[i] for i < n
+    typedef typename std::iterator_traits<I>::value_type T;
+    if (use_swaps) {
+        // equal counts mean the blocks may be mirror images, as in
+        // descending input; swapping pairwise keeps those linear
+        for (std::size_t i = 0; i < n; ++i)
+            std::iter_swap(first + offsets_l[i], last - offsets_r[i]);
+    } else if (n > 0) {
+        // a cycle through all the pairs moves each element once
+        I l = first + offsets_l[0];
+        I r = last - offsets_r[0];
+        T tmp(std::move(*l));
+        *l = std::move(*r);
+        for (std::size_t i = 1; i < n; ++i) {
+            l = first + offsets_l[i];
+            *r = std::move(*l);
+            r = last - offsets_r[i];
+            *l = std::move(*r);
+        }
+        *r = std::move(tmp);
+    }
+}
+
+template <typename I, typename R>
+// requires: I is RandomAccessIterator
+// requires: R is StrictWeakOrdering on the value type of I
+std::pair<I, bool> partition_right(I first, I last, R r, std::true_type) {
+    // the block partition of Edelkamp and Weiss (BlockQuicksort): each side
+    // records the offsets of its misplaced elements in a block by adding
+    // the outcome of the comparison to a count, with no branch on it, and
+    // the recorded elements are then exchanged in bulk
+    typedef typename std::iterator_traits<I>::value_type T;
+    T pivot(std::move(*first));
+    I f = first;
+    I l = last;
+    while (r(*++f, pivot));
+    if (f - 1 == first)
+        while (f < l && !r(*--l, pivot));
+    else
+        while (!r(*--l, pivot));
+    bool already_partitioned = f >= l;
+    if (!already_partitioned) {
+        std::iter_swap(f, l);
+        ++f;
+        unsigned char offsets_l[PDQSORT_BLOCK];
+        unsigned char offsets_r[PDQSORT_BLOCK];
+        I base_l = f;
+        I base_r = l;
+        std::size_t n_l = 0;
+        std::size_t n_r = 0;
+        std::size_t start_l = 0;
+        std::size_t start_r = 0;
+        while (f < l) {
+            // a side whose block is empty classifies up to a block of the
+            // unknown elements, sharing them if both are empty
+            std::size_t unknown = std::size_t(l - f);
+            std::size_t split_l = n_l == 0 ? (n_r == 0 ? unknown / 2 : unknown) : 0;
+            std::size_t split_r = n_r == 0 ? unknown - split_l : 0;
+            split_l = std::min(split_l, PDQSORT_BLOCK);
+            split_r = std::min(split_r, PDQSORT_BLOCK);
+            for (std::size_t i = 0; i < split_l; ++i) {
+                offsets_l[n_l] = static_cast<unsigned char>(i);
+                n_l += !r(*f, pivot);
+                ++f;
+            }
+            for (std::size_t i = 0; i < split_r; ++i) {
+                offsets_r[n_r] = static_cast<unsigned char>(i + 1);
+                n_r += r(*--l, pivot);
+            }
+            std::size_t n = std::min(n_l, n_r);
+            swap_offsets(base_l, base_r, offsets_l + start_l, offsets_r + start_r, n, n_l == n_r);
+            n_l -= n;
+            n_r -= n;
+            start_l += n;
+            start_r += n;
+            if (n_l == 0) {
+                start_l = 0;
+                base_l = f;
+            }
+            if (n_r == 0) {
+                start_r = 0;
+                base_r = l;
+            }
+        }
+        // the unknown range is used up; what remains in one block is moved
+        // to the boundary
+        if (n_l) {
+            while (n_l--) std::iter_swap(base_l + offsets_l[start_l + n_l], --l);
+            f = l;
+        }
+        if (n_r) {
+            while (n_r--) {
+                std::iter_swap(base_r - offsets_r[start_r + n_r], f);
+                ++f;
+            }
+        }
+    }
+    I pivot_position = f - 1;
+    *first = std::move(*pivot_position);
+    *pivot_position = std::move(pivot);
+    return std::make_pair(pivot_position, already_partitioned);
+}
+
+template <typename I, typename R>
+// requires: I is RandomAccessIterator
+// requires: R is StrictWeakOrdering on the value type of I
+I partition_left(I first, I last, R r) {
+    // precondition: *first is the pivot and no element of [first, last) is
+    //               less than it
+    // puts the elements equal to the pivot before the rest and returns the
+    // position of the last of them, so runs of equal keys are split off
+    // in linear time
+    typedef typename std::iterator_traits<I>::value_type T;
+    T pivot(std::move(*first));
+    I f = first;
+    I l = last;
+    while (r(pivot, *--l));
+    if (l + 1 == last)
+        while (f < l && !r(pivot, *++f));
+    else
+        while (!r(pivot, *++f));
+    while (f < l) {
+        std::iter_swap(f, l);
+        while (r(pivot, *--l));
+        while (!r(pivot, *++f));
+    }
+    *first = std::move(*l);
+    *l = std::move(pivot);
+    return l;
+}
+
+template <typename I>
+// requires: I is RandomAccessIterator
+inline
+void break_patterns(I first, I last) {
+    // swaps a few elements around the quarter points of a range whose
+    // partition came out unbalanced, so that a pattern that fooled the
+    // pivot selection does not do so again
+    typedef typename std::iterator_traits<I>::difference_type N;
+    N n = last - first;
+    if (n < N(PDQSORT_INSERTION_CUTOFF)) return;
+    N quarter = n / 4;
+    std::iter_swap(first, first + quarter);
+    std::iter_swap(last - 1, last - quarter);
+    if (n > N(PDQSORT_NINTHER_THRESHOLD)) {
+        std::iter_swap(first + 1, first + (quarter + 1));
+        std::iter_swap(first + 2, first + (quarter + 2));
+        std::iter_swap(last - 2, last - (quarter + 1));
+        std::iter_swap(last - 3, last - (quarter + 2));
+    }
+}
+
+template <typename I, typename R, typename B>
+// requires: I is RandomAccessIterator
+// requires: R is StrictWeakOrdering on the value type of I
+// requires: B is std::true_type if the block partition is to be used
+void pdqsort_loop(I first, I last, R r, int bad_allowed, bool leftmost, B branchless) {
+    // precondition: leftmost || !r(*first, *(first - 1)) for every element,
+    //               that is, the element before a partition is a sentinel
+    typedef typename std::iterator_traits<I>::difference_type N;
+    while (true) {
+        N n = last - first;
+        if (n < N(PDQSORT_INSERTION_CUTOFF)) {
+            // the pivot left of the partition stops the unguarded insertions
+            if (leftmost)
+                insertion_sort(first, last, r);
+            else
+                insertion_sort_suffix(first, last, r);
+            return;
+        }
+
+        N half = n / 2;
+        if (n > N(PDQSORT_NINTHER_THRESHOLD)) {
+            sort_three(first, first + half, last - 1, r);
+            sort_three(first + 1, first + (half - 1), last - 2, r);
+            sort_three(first + 2, first + (half + 1), last - 3, r);
+            sort_three(first + (half - 1), first + half, first + (half + 1), r);
+            std::iter_swap(first, first + half);
+        } else {
+            sort_three(first + half, first, last - 1, r);
+        }
+
+        // a pivot equal to the sentinel is the smallest element, so the
+        // partition would be empty; take the whole run of its equals instead
+        if (!leftmost && !r(*(first - 1), *first)) {
+            first = partition_left(first, last, r) + 1;
+            continue;
+        }
+
+        std::pair<I, bool> p = partition_right(first, last, r, branchless);
+        I pivot = p.first;
+        N n_l = pivot - first;
+        N n_r = last - (pivot + 1);
+
+        if (n_l < n / 8 || n_r < n / 8) {
+            if (--bad_allowed == 0) {
+                std::make_heap(first, last, r);
+                std::sort_heap(first, last, r);
+                return;
+            }
+            break_patterns(first, pivot);
+            break_patterns(pivot + 1, last);
+        } else if (p.second && partial_insertion_sort(first, pivot, r) &&
+                   partial_insertion_sort(pivot + 1, last, r)) {
+            // nothing moved during the partition and both sides turned out
+            // to be (nearly) sorted
+            return;
+        }
+
+        pdqsort_loop(first, pivot, r, bad_allowed, leftmost, branchless);
+        first = pivot + 1;
+        leftmost = false;
+    }
+}
+
+template <typename I, typename R>
+// requires: I is RandomAccessIterator
+// requires: R is StrictWeakOrdering on the value type of I
+void pdqsort(I first, I last, R r) {
+    // sorts in O(n log n) comparisons in the worst case and in O(n) for
+    // ascending and descending input
+    typedef typename std::iterator_traits<I>::difference_type N;
+    N n = last - first;
+    if (n < 2) return;
+    // a range that is one ascending or one descending run is handled by a
+    // scan, which costs two comparisons on random input
+    I i = first + 1;
+    if (r(*i, *first)) {
+        while (++i != last && !r(*(i - 1), *i));
+        if (i == last) {
+            ::reverse(first, last);
+            return;
+        }
+    } else {
+        while (++i != last && !r(*i, *(i - 1)));
+        if (i == last) return;
+    }
+    int bad_allowed = 1;
+    while (n >>= 1) ++bad_allowed;
+    pdqsort_loop(first, last, r, bad_allowed, true, typename is_branchless_partitionable<I, R>::type{});
+}
+
+template <typename I>
+// requires: I is RandomAccessIterator with a TotallyOrdered value type
+inline
+void pdqsort(I first, I last) {
+    typedef typename std::iterator_traits<I>::value_type T;
+    pdqsort(first, last, std::less<T>{});
+}
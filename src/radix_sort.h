@@ -0,0 +1,319 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include "insertion_sort.h"
+#include "move.h"
+#include "temporary_buffer.h"
+
+// Radix sorts order elements by an unsigned integer key that a key
+// function extracts from them, a byte at a time
+
+const std::size_t RADIX_BITS = 8;
+const std::size_t RADIX_BUCKETS = std::size_t(1) << RADIX_BITS;
+
+// MSD buckets smaller than this are finished by insertion sort
+const std::size_t RADIX_MSD_CUTOFF = 64;
+
+// the scatter prefetches the destination of the element this far ahead
+const std::size_t RADIX_PREFETCH_DISTANCE = 16;
+
+template <typename T, typename Enable = void>
+struct radix_key;
+
+template <typename T>
+// requires: T is an integral type other than bool
+struct radix_key<T, typename std::enable_if<std::is_integral<T>::value>::type>
+{
+    // flipping the sign bit orders signed values as unsigned ones
+    typedef typename std::make_unsigned<T>::type result_type;
+    result_type operator()(T x) const {
+        const result_type sign = std::is_signed<T>::value ? result_type(result_type(1) << (8 * sizeof(T) - 1)) : 0;
+        return result_type(x) ^ sign;
+    }
+};
+
+template <typename T>
+// requires: T is float or double
+struct radix_key<T, typename std::enable_if<std::is_floating_point<T>::value>::type>
+{
+    // IEEE 754 values order like their bits once negative values have all
+    // bits flipped and positive values the sign bit; -0.0 comes before 0.0
+    // and NaNs go to the ends
+    typedef typename std::conditional<sizeof(T) == 4, std::uint32_t, std::uint64_t>::type result_type;
+    result_type operator()(T x) const {
+        static_assert(sizeof(T) == sizeof(result_type), "IEEE 754 single or double precision");
+        const result_type sign = result_type(1) << (8 * sizeof(T) - 1);
+        result_type bits;
+        std::memcpy(&bits, &x, sizeof(T));
+        return bits & sign ? ~bits : bits | sign;
+    }
+};
+
+template <typename K>
+// requires: K is a key function returning an unsigned integral type
+class key_less
+{
+    // the ordering a radix sort with key function K produces
+private:
+    K key;
+public:
+    key_less(const K& key) : key{ key } {}
+    template <typename T>
+    bool operator()(const T& x, const T& y) const { return key(x) < key(y); }
+};
+
+template <typename I, typename K>
+// requires: I is Iterator
+// requires: K is a key function on the value type of I
+struct radix_key_type
+{
+    typedef typename std::decay<decltype(std::declval<K&>()(*std::declval<I>()))>::type type;
+    static_assert(std::is_unsigned<type>::value, "radix keys are unsigned integers");
+    static const std::size_t digits = (8 * sizeof(type) + RADIX_BITS - 1) / RADIX_BITS;
+};
+
+template <typename U>
+// requires: U is an unsigned integral type
+inline
+std::size_t radix_digit(U k, std::size_t shift) {
+    return std::size_t(k >> shift) & (RADIX_BUCKETS - 1);
+}
+
+template <typename T>
+inline
+void prefetch_for_write(const T* p) {
+#if defined(__GNUC__)
+    __builtin_prefetch(p, 1);
+#else
+    (void)p;
+#endif
+}
+
+template <typename I, typename K>
+// requires: I is InputIterator
+// requires: K is a key function on the value type of I
+void radix_histograms(I first, I last, K key, std::size_t* counts) {
+    // counts[d * RADIX_BUCKETS + b] is incremented for every element whose
+    // digit d is b; all digits are counted in a single pass
+    typedef typename radix_key_type<I, K>::type U;
+    const std::size_t D = radix_key_type<I, K>::digits;
+    while (first != last) {
+        U k = key(*first);
+        for (std::size_t d = 0; d < D; ++d)
+            ++counts[d * RADIX_BUCKETS + radix_digit(k, d * RADIX_BITS)];
+        ++first;
+    }
+}
+
+template <typename I, typename K>
+// requires: I is InputIterator
+// requires: K is a key function on the value type of I
+void radix_histogram(I first, I last, K key, std::size_t shift, std::size_t* counts) {
+    // counts the digit at shift
+    while (first != last) {
+        ++counts[radix_digit(key(*first), shift)];
+        ++first;
+    }
+}
+
+inline
+bool radix_trivial_digit(const std::size_t* counts, std::size_t n) {
+    // all elements have the same digit, so the pass would not move them
+    for (std::size_t b = 0; b < RADIX_BUCKETS; ++b)
+        if (counts[b]) return counts[b] == n;
+    return true;
+}
+
+inline
+void radix_offsets(std::size_t* counts) {
+    // turns the counts of a digit into the start of each bucket
+    std::size_t sum = 0;
+    for (std::size_t b = 0; b < RADIX_BUCKETS; ++b) {
+        std::size_t c = counts[b];
+        counts[b] = sum;
+        sum += c;
+    }
+}
+
+template <typename I, typename O, typename K>
+// requires: I is RandomAccessIterator
+// requires: O is RandomAccessIterator with the value type of I
+// requires: K is a key function on the value type of I
+void radix_scatter(I first, I last, O result, K key, std::size_t shift, std::size_t* offsets) {
+    // moves each element to the next free place of its bucket; elements
+    // that share a digit keep their order. Destinations are spread over
+    // all the buckets, so the place of an element a few iterations ahead
+    // is prefetched
+    typedef typename std::iterator_traits<I>::difference_type N;
+    N n = last - first;
+    N ahead = std::min(n, N(RADIX_PREFETCH_DISTANCE));
+    N i = 0;
+    for (; i < n - ahead; ++i) {
+        prefetch_for_write(std::addressof(result[offsets[radix_digit(key(first[i + ahead]), shift)]]));
+        std::size_t b = radix_digit(key(first[i]), shift);
+        result[offsets[b]++] = std::move(first[i]);
+    }
+    for (; i < n; ++i) {
+        std::size_t b = radix_digit(key(first[i]), shift);
+        result[offsets[b]++] = std::move(first[i]);
+    }
+}
+
+template <typename I, typename K, typename B>
+// requires: I is RandomAccessIterator
+// requires: K is a key function on the value type of I
+// requires: B is a pointer to the value type of I
+void radix_sort_lsd_passes(I first, I last, K key, B buffer, bool in_buffer) {
+    // precondition: the buffer holds last - first constructed elements
+    // the elements are in the buffer if in_buffer and in [first, last)
+    // otherwise; they end up sorted in [first, last). One pass counts every
+    // digit, then each digit that does not have all elements in one bucket
+    // is scattered from the least significant one up, back and forth
+    // between the range and the buffer
+    typedef typename std::iterator_traits<I>::difference_type N;
+    const std::size_t D = radix_key_type<I, K>::digits;
+    N n = last - first;
+    std::size_t counts[D * RADIX_BUCKETS] = {};
+    if (in_buffer)
+        radix_histograms(buffer, buffer + n, key, counts);
+    else
+        radix_histograms(first, last, key, counts);
+    for (std::size_t d = 0; d < D; ++d) {
+        std::size_t* offsets = counts + d * RADIX_BUCKETS;
+        if (radix_trivial_digit(offsets, std::size_t(n))) continue;
+        radix_offsets(offsets);
+        if (in_buffer)
+            radix_scatter(buffer, buffer + n, first, key, d * RADIX_BITS, offsets);
+        else
+            radix_scatter(first, last, buffer, key, d * RADIX_BITS, offsets);
+        in_buffer = !in_buffer;
+    }
+    if (in_buffer) std::move(buffer, buffer + n, first);
+}
+
+template <typename I, typename K, typename B>
+// requires: I is RandomAccessIterator
+// requires: K is a key function on the value type of I
+// requires: B is a pointer to the value type of I
+inline
+void radix_sort_lsd(I first, I last, K key, B buffer) {
+    // precondition: the buffer holds last - first constructed elements
+    // stable
+    radix_sort_lsd_passes(first, last, key, buffer, false);
+}
+
+template <typename I, typename K>
+// requires: I is RandomAccessIterator
+// requires: K is a key function on the value type of I
+void radix_sort_lsd(I first, I last, K key) {
+    // the elements are moved into the buffer to construct it, and the
+    // passes start from there
+    typedef typename std::iterator_traits<I>::value_type T;
+    temporary_buffer<T> buffer(last - first);
+    T* buffer_last = ::uninitialized_move(first, last, buffer.begin());
+    destroy_guard<T> guard(buffer.begin(), buffer_last);
+    radix_sort_lsd_passes(first, last, key, buffer.begin(), true);
+}
+
+template <typename I>
+// requires: I is RandomAccessIterator with an integral or floating point value type
+inline
+void radix_sort_lsd(I first, I last) {
+    typedef typename std::iterator_traits<I>::value_type T;
+    radix_sort_lsd(first, last, radix_key<T>{});
+}
+
+template <typename I, typename K>
+// requires: I is RandomAccessIterator
+// requires: K is a key function on the value type of I
+void radix_sort_msd(I first, I last, K key, std::size_t shift) {
+    // the American flag sort: counts the digit at shift, permutes the
+    // elements into their buckets in place by following cycles, and
+    // recurses into each bucket with the next digit
+    typedef typename std::iterator_traits<I>::difference_type N;
+    while (true) {
+        std::size_t n = std::size_t(last - first);
+        if (n < RADIX_MSD_CUTOFF) {
+            linear_insertion_sort_n(first, N(n), key_less<K>(key));
+            return;
+        }
+        std::size_t counts[RADIX_BUCKETS] = {};
+        radix_histogram(first, last, key, shift, counts);
+        if (radix_trivial_digit(counts, n)) {
+            if (shift == 0) return;
+            shift -= RADIX_BITS;
+            continue;
+        }
+        std::size_t heads[RADIX_BUCKETS];
+        std::size_t tails[RADIX_BUCKETS];
+        std::size_t sum = 0;
+        for (std::size_t b = 0; b < RADIX_BUCKETS; ++b) {
+            heads[b] = sum;
+            sum += counts[b];
+            tails[b] = sum;
+        }
+        for (std::size_t b = 0; b < RADIX_BUCKETS; ++b) {
+            while (heads[b] < tails[b]) {
+                I x = first + N(heads[b]);
+                std::size_t d = radix_digit(key(*x), shift);
+                while (d != b) {
+                    std::iter_swap(x, first + N(heads[d]++));
+                    d = radix_digit(key(*x), shift);
+                }
+                ++heads[b];
+            }
+        }
+        if (shift == 0) return;
+        std::size_t start = 0;
+        for (std::size_t b = 0; b < RADIX_BUCKETS; ++b) {
+            if (counts[b] > 1)
+                radix_sort_msd(first + N(start), first + N(start + counts[b]), key, shift - RADIX_BITS);
+            start += counts[b];
+        }
+        return;
+    }
+}
+
+template <typename I, typename K>
+// requires: I is RandomAccessIterator
+// requires: K is a key function on the value type of I
+inline
+void radix_sort_msd(I first, I last, K key) {
+    // in place and not stable
+    const std::size_t D = radix_key_type<I, K>::digits;
+    radix_sort_msd(first, last, key, (D - 1) * RADIX_BITS);
+}
+
+template <typename I>
+// requires: I is RandomAccessIterator with an integral or floating point value type
+inline
+void radix_sort_msd(I first, I last) {
+    typedef typename std::iterator_traits<I>::value_type T;
+    radix_sort_msd(first, last, radix_key<T>{});
+}
+
+template <typename I, typename K>
+// requires: I is RandomAccessIterator
+// requires: K is a key function on the value type of I
+inline
+void radix_sort(I first, I last, K key, bool stable = true) {
+    // LSD with a buffer when equal keys must keep their order, otherwise
+    // MSD in place
+    if (stable)
+        radix_sort_lsd(first, last, key);
+    else
+        radix_sort_msd(first, last, key);
+}
+
+template <typename I>
+// requires: I is RandomAccessIterator with an integral or floating point value type
+inline
+void radix_sort(I first, I last) {
+    typedef typename std::iterator_traits<I>::value_type T;
+    radix_sort_lsd(first, last, radix_key<T>{});
+}
@@ -0,0 +1,211 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include "move.h"
+#include "reverse.h"
+
+template <typename I>
+// requires: I is ForwardIterator
+I rotate_gries_mills(I first, I middle, I last) {
+    // block swaps: swaps the shorter side into place and continues with the
+    // rest; n - gcd(k, n - k) swaps, all of them sequential
+    if (first == middle) return last;
+    if (middle == last) return first;
+    I first2 = middle;
+    do {
+        std::iter_swap(first++, first2++);
+        if (first == middle) middle = first2;
+    } while (first2 != last);
+    I result = first;
+    first2 = middle;
+    while (first2 != last) {
+        std::iter_swap(first++, first2++);
+        if (first == middle) middle = first2;
+        else if (first2 == last) first2 = middle;
+    }
+    return result;
+}
+
+template <typename I>
+// requires: I is BidirectionalIterator
+I rotate_three_reversal(I first, I middle, I last) {
+    if (first == middle) return last;
+    if (middle == last) return first;
+    ::reverse(first, middle);
+    ::reverse(middle, last);
+    // the final reversal stops where the former middle lands
+    using std::swap;
+    while (first != middle && middle != last) {
+        --last;
+        swap(*first, *last);
+        ++first;
+    }
+    if (first == middle) {
+        ::reverse(middle, last);
+        return last;
+    }
+    ::reverse(first, middle);
+    return first;
+}
+
+template <typename N>
+// requires: N is Integral
+N gcd(N a, N b) {
+    while (b != N(0)) {
+        N t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+template <typename I>
+// requires: I is RandomAccessIterator
+I rotate_cycle_leader(I first, I middle, I last) {
+    // follows the gcd(k, n - k) cycles of the permutation: n + gcd moves,
+    // the minimum, but with a stride of k through memory
+    typedef typename std::iterator_traits<I>::value_type T;
+    typedef typename std::iterator_traits<I>::difference_type N;
+    N k = middle - first;
+    N n = last - first;
+    if (k == N(0)) return last;
+    if (k == n) return first;
+    N cycles = ::gcd(k, n - k);
+    for (N i = 0; i < cycles; ++i) {
+        T tmp = std::move(first[i]);
+        N j = i;
+        while (true) {
+            N next = j + k;
+            if (next >= n) next -= n;
+            if (next == i) break;
+            first[j] = std::move(first[next]);
+            j = next;
+        }
+        first[j] = std::move(tmp);
+    }
+    return first + (n - k);
+}
+
+// cycle leaders move each element once but stride through memory, which
+// only pays for large elements in ranges that stay in cache
+const std::size_t ROTATE_CYCLE_LEADER_SIZE = 64;
+const std::size_t ROTATE_CYCLE_LEADER_BYTES = std::size_t(1) << 18;
+
+template <typename I>
+// requires: I is ForwardIterator
+inline
+I rotate(I first, I middle, I last, std::forward_iterator_tag) {
+    return rotate_gries_mills(first, middle, last);
+}
+
+template <typename I>
+// requires: I is BidirectionalIterator
+inline
+I rotate(I first, I middle, I last, std::bidirectional_iterator_tag) {
+    return rotate_three_reversal(first, middle, last);
+}
+
+template <typename I>
+// requires: I is RandomAccessIterator
+inline
+I rotate(I first, I middle, I last, std::random_access_iterator_tag) {
+    typedef typename std::iterator_traits<I>::value_type T;
+    if (sizeof(T) >= ROTATE_CYCLE_LEADER_SIZE &&
+        std::size_t(last - first) * sizeof(T) <= ROTATE_CYCLE_LEADER_BYTES)
+        return rotate_cycle_leader(first, middle, last);
+    return rotate_gries_mills(first, middle, last);
+}
+
+template <typename I>
+// requires: I is ForwardIterator
+inline
+I rotate(I first, I middle, I last) {
+    // returns the new position of *first, as std::rotate does
+    return ::rotate(first, middle, last, typename std::iterator_traits<I>::iterator_category{});
+}
+
+template <typename I, typename B>
+// requires: I is ForwardIterator
+// requires: B is a pointer to the value type of I
+I rotate_left_with_buffer(I first, I middle, I last, B buffer) {
+    // precondition: the buffer is uninitialized storage for std::distance(first, middle) elements
+    B buffer_last = ::uninitialized_move(first, middle, buffer);
+    destroy_guard<typename std::iterator_traits<B>::value_type> guard(buffer, buffer_last);
+    first = std::move(middle, last, first);
+    std::move(buffer, buffer_last, first);
+    return first;
+}
+
+template <typename I, typename B>
+// requires: I is BidirectionalIterator
+// requires: B is a pointer to the value type of I
+I rotate_right_with_buffer(I first, I middle, I last, B buffer) {
+    // precondition: the buffer is uninitialized storage for std::distance(middle, last) elements
+    B buffer_last = ::uninitialized_move(middle, last, buffer);
+    destroy_guard<typename std::iterator_traits<B>::value_type> guard(buffer, buffer_last);
+    I result = std::move_backward(first, middle, last);
+    std::move(buffer, buffer_last, first);
+    return result;
+}
+
+template <typename I, typename B, typename N>
+// requires: I is ForwardIterator
+// requires: B is a pointer to the value type of I
+// requires: N is Integral
+I rotate(I first, I middle, I last, B buffer, N buffer_size, std::forward_iterator_tag) {
+    if (first != middle && middle != last && N(std::distance(first, middle)) <= buffer_size)
+        return rotate_left_with_buffer(first, middle, last, buffer);
+    return ::rotate(first, middle, last);
+}
+
+template <typename I, typename B, typename N>
+// requires: I is BidirectionalIterator
+// requires: B is a pointer to the value type of I
+// requires: N is Integral
+I rotate(I first, I middle, I last, B buffer, N buffer_size, std::bidirectional_iterator_tag) {
+    if (first == middle || middle == last) return ::rotate(first, middle, last);
+    N n0 = N(std::distance(first, middle));
+    N n1 = N(std::distance(middle, last));
+    if (n0 <= n1 && n0 <= buffer_size)
+        return rotate_left_with_buffer(first, middle, last, buffer);
+    if (n1 < n0 && n1 <= buffer_size)
+        return rotate_right_with_buffer(first, middle, last, buffer);
+    return ::rotate(first, middle, last);
+}
+
+template <typename I, typename B, typename N>
+// requires: I is ForwardIterator
+// requires: B is a pointer to the value type of I
+// requires: N is Integral
+inline
+I rotate(I first, I middle, I last, B buffer, N buffer_size) {
+    // moves the smaller side through the buffer when it fits
+    return ::rotate(first, middle, last, buffer, buffer_size,
+                    typename std::iterator_traits<I>::iterator_category{});
+}
+
+struct rotator
+{
+    template <typename I>
+    I operator()(I first, I middle, I last) const {
+        return ::rotate(first, middle, last);
+    }
+};
+
+template <typename B, typename N>
+// requires: B is a pointer
+// requires: N is Integral
+struct buffered_rotator
+{
+    B buffer;
+    N buffer_size;
+    buffered_rotator(B buffer, N buffer_size) : buffer{ buffer }, buffer_size{ buffer_size } {}
+
+    template <typename I>
+    I operator()(I first, I middle, I last) const {
+        return ::rotate(first, middle, last, buffer, buffer_size);
+    }
+};
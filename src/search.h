@@ -1,22 +1,51 @@
 #pragma once
 #include <utility>
 #include <iterator>
+#include <functional>
+#include <memory>
+#include "simd_find.h"
 
 template <typename I, typename P>
 // requires: I is InputIterator
 // requires: P is UnaryPredicate on ValueType(I)
-I find_if(I first, I last, P pred) {
+I find_if(I first, I last, P pred, std::false_type) {
     // Precondition: [first, last) is a valid range
     while (first != last && !pred(*first)) ++first;
     return first;
     // Postcondition: return value is either last OR pred(*first) = true
 }
 
+#if defined(__GNUC__)
+
+template <typename I, typename P>
+// requires: I is ContiguousIterator
+// requires: P is UnaryPredicate on ValueType(I)
+inline
+I find_if(I first, I last, P pred, std::true_type) {
+    if (first == last) return last;
+    typedef typename std::iterator_traits<I>::value_type T;
+    const T* p = std::addressof(*first);
+    return first + (find_simd<true>(p, p + (last - first), pred) - p);
+}
+
+#endif
+
+template <typename I, typename P>
+// requires: I is InputIterator
+// requires: P is UnaryPredicate on ValueType(I)
+inline
+I find_if(I first, I last, P pred) {
+    // Precondition: [first, last) is a valid range
+    // a vector of elements at a time when they are numbers in contiguous
+    // memory and pred compares them to constants, like in_range
+    return ::find_if(first, last, pred, typename is_simd_findable<I, P>::type{});
+}
+
 template <typename I, typename N, typename P>
 // requires: I is InputIterator
 // requires: N is integral
 // requires: P is UnaryPredicate on ValueType(I)
-std::pair<I, N> find_if_n(I first, N n, P pred) {
+std::pair<I, N> find_if_n(I first, N n, P pred, std::false_type) {
     // Precondition: [first, n) is a valid range
     while (n != N(0) && !pred(*first)) {
         ++first;
@@ -25,21 +54,72 @@ std::pair<I, N> find_if_n(I first, N n, P pred) {
     return std::make_pair(first, n);    
 }
 
+#if defined(__GNUC__)
+
+template <typename I, typename N, typename P>
+// requires: I is ContiguousIterator
+// requires: N is integral
+// requires: P is UnaryPredicate on ValueType(I)
+inline
+std::pair<I, N> find_if_n(I first, N n, P pred, std::true_type) {
+    if (n == N(0)) return std::make_pair(first, n);
+    typedef typename std::iterator_traits<I>::value_type T;
+    const T* p = std::addressof(*first);
+    N i = N(find_simd<true>(p, p + n, pred) - p);
+    return std::make_pair(first + i, n - i);
+}
+
+#endif
+
+template <typename I, typename N, typename P>
+// requires: I is InputIterator
+// requires: N is integral
+// requires: P is UnaryPredicate on ValueType(I)
+inline
+std::pair<I, N> find_if_n(I first, N n, P pred) {
+    // Precondition: [first, n) is a valid range
+    return ::find_if_n(first, n, pred, typename is_simd_findable<I, P>::type{});
+}
+
 template <typename I, typename P>
 // requires: I is InputIterator
 // requires: P is UnaryPredicate on ValueType(I)
-I find_if_not(I first, I last, P pred) {
+I find_if_not(I first, I last, P pred, std::false_type) {
     // Precondition: [first, last) is a valid range
     while (first != last && pred(*first)) ++first;
     return first;
     // Postcondition: return value is either last OR pred(*first) = false
 }
 
+#if defined(__GNUC__)
+
+template <typename I, typename P>
+// requires: I is ContiguousIterator
+// requires: P is UnaryPredicate on ValueType(I)
+inline
+I find_if_not(I first, I last, P pred, std::true_type) {
+    if (first == last) return last;
+    typedef typename std::iterator_traits<I>::value_type T;
+    const T* p = std::addressof(*first);
+    return first + (find_simd<false>(p, p + (last - first), pred) - p);
+}
+
+#endif
+
+template <typename I, typename P>
+// requires: I is InputIterator
+// requires: P is UnaryPredicate on ValueType(I)
+inline
+I find_if_not(I first, I last, P pred) {
+    // Precondition: [first, last) is a valid range
+    return ::find_if_not(first, last, pred, typename is_simd_findable<I, P>::type{});
+}
+
 template <typename I, typename N, typename P>
 // requires: I is InputIterator
 // requires: N is integral
 // requires: P is UnaryPredicate on ValueType(I)
-std::pair<I, N> find_if_not_n(I first, N n, P pred) {
+std::pair<I, N> find_if_not_n(I first, N n, P pred, std::false_type) {
     // Precondition: [first, n) is a valid range
     while (n != N(0) && pred(*first)) {
         ++first;
@@ -48,13 +128,40 @@ std::pair<I, N> find_if_not_n(I first, N n, P pred) {
     return std::make_pair(first, n);    
 }
 
+#if defined(__GNUC__)
+
+template <typename I, typename N, typename P>
+// requires: I is ContiguousIterator
+// requires: N is integral
+// requires: P is UnaryPredicate on ValueType(I)
+inline
+std::pair<I, N> find_if_not_n(I first, N n, P pred, std::true_type) {
+    if (n == N(0)) return std::make_pair(first, n);
+    typedef typename std::iterator_traits<I>::value_type T;
+    const T* p = std::addressof(*first);
+    N i = N(find_simd<false>(p, p + n, pred) - p);
+    return std::make_pair(first + i, n - i);
+}
+
+#endif
+
+template <typename I, typename N, typename P>
+// requires: I is InputIterator
+// requires: N is integral
+// requires: P is UnaryPredicate on ValueType(I)
+inline
+std::pair<I, N> find_if_not_n(I first, N n, P pred) {
+    // Precondition: [first, n) is a valid range
+    return ::find_if_not_n(first, n, pred, typename is_simd_findable<I, P>::type{});
+}
+
 template <typename I, typename P>
 // requires: I is InputIterator
 // requires: P is UnaryPredicate on ValueType(I)
 inline
 bool all_of(I first, I last, P pred) {
     // Precondition: [first, last) is a valid range
-    return find_if_not(first, last, pred) == last;    
+    return ::find_if_not(first, last, pred) == last;    
 }
 
 template <typename I, typename P>
@@ -63,7 +170,7 @@ template <typename I, typename P>
 inline
 bool none_of(I first, I last, P pred) {
     // Precondition: [first, last) is a valid range
-    return find_if(first, last, pred) == last;
+    return ::find_if(first, last, pred) == last;
 }
 
 template <typename I, typename P>
@@ -72,7 +179,7 @@ template <typename I, typename P>
 inline
 bool any_of(I first, I last, P pred) {
     // Precondition: [first, last) is a valid range
-    return find_if(first, last, pred) != last;
+    return ::find_if(first, last, pred) != last;
 }
 
 template <typename I, typename P>
@@ -80,7 +187,7 @@ template <typename I, typename P>
 // requires: P is UnaryPredicate on ValueType(I)
 bool is_partitioned(I first, I last, P pred) {
     // Precondition: [first, last) is a valid range
-    return find_if(find_if_not(first, last, pred), last, pred) == last;
+    return ::find_if(::find_if_not(first, last, pred), last, pred) == last;
 }
 
 template <typename I, typename N, typename P>
@@ -89,8 +196,8 @@ template <typename I, typename N, typename P>
 // requires: P is UnaryPredicate on ValueType(I)
 bool is_partitioned_n(I first, N n, P pred) {
     // Precondition: [first, last) is a valid range
-    std::pair<I, N> x = find_if_not_n(first, n, pred);
-    return find_if_n(x.first, x.second, pred).second == N(0);
+    std::pair<I, N> x = ::find_if_not_n(first, n, pred);
+    return ::find_if_n(x.first, x.second, pred).second == N(0);
 }
 
 template <typename I, typename N>
@@ -157,31 +264,198 @@ I partition_point(I first, I last, P pred) {
     return partition_point_n(first, distance(first, last), pred);
 }
 
+template <typename I, typename N, typename P>
+// requires: I is ForwardIterator
+// requires: N is Integral
+// requires: P is UnaryPredicate on the value type of I
+I partition_point_gallop_n(I first, N n, P pred) {
+    // precondition: is_partitioned_n(first, n, pred)
+    // probes at distances 1, 3, 7, 15, ... before bisecting the last gap,
+    // so a partition point at distance d costs O(log d) applications of pred
+    N step(1);
+    while (step <= n) {
+        I probe = first;
+        ::advance(probe, step - N(1));
+        if (!pred(*probe)) return partition_point_n(first, step - N(1), pred);
+        first = ++probe;
+        n -= step;
+        step <<= 1;
+    }
+    return partition_point_n(first, n, pred);
+}
+
+template <typename I, typename N, typename P>
+// requires: I is BidirectionalIterator
+// requires: N is Integral
+// requires: P is UnaryPredicate on the value type of I
+I partition_point_gallop_backward_n(I last, N n, P pred) {
+    // precondition: is_partitioned_n(std::prev(last, n), n, pred)
+    // partition_point_gallop_n from the other end: probes at distances 1,
+    // 3, 7, 15, ... before last, so a partition point at distance d before
+    // last costs O(log d) applications of pred
+    N step(1);
+    while (step <= n) {
+        I probe = std::prev(last, step);
+        if (pred(*probe)) return partition_point_n(std::next(probe), step - N(1), pred);
+        last = probe;
+        n -= step;
+        step <<= 1;
+    }
+    return partition_point_n(std::prev(last, n), n, pred);
+}
+
+template <typename I, typename N>
+// requires: I is ForwardIterator
+// requires: N is Integral
+N advance_at_most(I& i, N n, I last, std::forward_iterator_tag) {
+    N k(0);
+    while (k < n && i != last) {
+        ++i;
+        ++k;
+    }
+    return k;
+}
+
+template <typename I, typename N>
+// requires: I is RandomAccessIterator
+// requires: N is Integral
+N advance_at_most(I& i, N n, I last, std::random_access_iterator_tag) {
+    N k = last - i < n ? N(last - i) : n;
+    i += k;
+    return k;
+}
+
+template <typename I, typename N>
+// requires: I is ForwardIterator
+// requires: N is Integral
+inline
+N advance_at_most(I& i, N n, I last) {
+    // advances i by n, or to last if that is nearer; returns the distance moved
+    return advance_at_most(i, n, last, typename std::iterator_traits<I>::iterator_category{});
+}
+
+template <typename I, typename P>
+// requires: I is ForwardIterator
+// requires: P is UnaryPredicate on the value type of I
+I partition_point_gallop(I first, I last, P pred) {
+    // precondition: is_partitioned(first, last, pred)
+    // partition_point_gallop_n without the length: a partition point at
+    // distance d costs O(log d) applications of pred and, unless I is
+    // random access, O(d) increments
+    typedef typename std::iterator_traits<I>::difference_type N;
+    N step(1);
+    while (true) {
+        I probe = first;
+        N k = advance_at_most(probe, step - N(1), last);
+        if (probe == last || !pred(*probe)) return partition_point_n(first, k, pred);
+        first = ++probe;
+        step <<= 1;
+    }
+}
+
+template <typename I, typename P>
+// requires: I is BidirectionalIterator
+// requires: P is UnaryPredicate on the value type of I
+I partition_point_gallop_backward(I first, I last, P pred) {
+    // precondition: is_partitioned(first, last, pred)
+    // partition_point_gallop from the other end
+    typedef typename std::iterator_traits<I>::difference_type N;
+    typedef std::reverse_iterator<I> RI;
+    N step(1);
+    while (true) {
+        RI probe(last);
+        N k = advance_at_most(probe, step - N(1), RI(first));
+        if (probe == RI(first)) return partition_point_n(first, k, pred);
+        if (pred(*probe)) return partition_point_n(probe.base(), k, pred);
+        last = std::prev(probe.base());
+        step <<= 1;
+    }
+}
+
+template <typename I, typename P>
+// requires: I is ForwardIterator
+// requires: P is UnaryPredicate on the value type of I
+inline
+I partition_point_hint(I first, I last, I hint, P pred, std::forward_iterator_tag) {
+    // precondition: all_of(first, hint, pred)
+    // a forward iterator can only look ahead of the hint
+    (void)first;
+    return partition_point_gallop(hint, last, pred);
+}
+
+template <typename I, typename P>
+// requires: I is BidirectionalIterator
+// requires: P is UnaryPredicate on the value type of I
+inline
+I partition_point_hint(I first, I last, I hint, P pred, std::bidirectional_iterator_tag) {
+    if (hint != last && pred(*hint)) return partition_point_gallop(std::next(hint), last, pred);
+    return partition_point_gallop_backward(first, hint, pred);
+}
+
+template <typename I, typename P>
+// requires: I is ForwardIterator
+// requires: P is UnaryPredicate on the value type of I
+inline
+I partition_point_hint(I first, I last, I hint, P pred) {
+    // precondition: is_partitioned(first, last, pred) and hint is in [first, last]
+    // gallops outward from hint, so a partition point at distance d from
+    // hint costs O(log d) applications of pred
+    return partition_point_hint(first, last, hint, pred,
+                                typename std::iterator_traits<I>::iterator_category{});
+}
+
 template <typename I, typename R>
 // requires: I is forward iterator
 // requires: R is WeakStrictOrdering on the value type of I
-bool is_sorted(I first, I last, R r) {
+bool is_sorted(I first, I last, R r, std::false_type) {
     if (first == last) return true;
     I previous = first;
     while (++first != last && !r(*first, *previous)) previous = first;
     return first == last;
 }
 
+#if defined(__GNUC__)
+
+template <typename I, typename R>
+// requires: I is ContiguousIterator
+// requires: R is std::less on the value type of I
+inline
+bool is_sorted(I first, I last, R, std::true_type) {
+    if (first == last) return true;
+    typedef typename std::iterator_traits<I>::value_type T;
+    const T* p = std::addressof(*first);
+    const T* q = p + (last - first);
+    return is_sorted_until_simd(p, q) == q;
+}
+
+#endif
+
+template <typename I, typename R>
+// requires: I is forward iterator
+// requires: R is WeakStrictOrdering on the value type of I
+inline
+bool is_sorted(I first, I last, R r) {
+    // numbers in contiguous memory ordered by std::less are compared a
+    // vector of neighbours at a time
+    return ::is_sorted(first, last, r, typename is_simd_comparable<I, R>::type{});
+}
+
 template <typename I>
 // requires: I is ForwardIterator with a totally ordered value type
 inline
 bool is_sorted(I first, I last) {
     typedef typename std::iterator_traits<I>::value_type T;
-    return is_sorted(first, last, std::less<T>{});
+    return ::is_sorted(first, last, std::less<T>{});
 }
 
 template <typename I, typename N, typename R>
 // requires: I is ForwardIterator
 // requires: N is integral
 // requires: P is UnaryPredicate on ValueType(I)
-bool is_sorted_n(I first, N n, R r) {
+bool is_sorted_n(I first, N n, R r, std::false_type) {
     if (!n) return true;
     I previous = first;    
+    --n;
     while (n && !r(*++first, *previous)) {
         previous = first;
         --n;
@@ -189,6 +463,31 @@ bool is_sorted_n(I first, N n, R r) {
     return !n;
 }
 
+#if defined(__GNUC__)
+
+template <typename I, typename N, typename R>
+// requires: I is ContiguousIterator
+// requires: N is integral
+// requires: R is std::less on the value type of I
+inline
+bool is_sorted_n(I first, N n, R, std::true_type) {
+    if (!n) return true;
+    typedef typename std::iterator_traits<I>::value_type T;
+    const T* p = std::addressof(*first);
+    return is_sorted_until_simd(p, p + n) == p + n;
+}
+
+#endif
+
+template <typename I, typename N, typename R>
+// requires: I is ForwardIterator
+// requires: N is integral
+// requires: R is WeakStrictOrdering on ValueType(I)
+inline
+bool is_sorted_n(I first, N n, R r) {
+    return ::is_sorted_n(first, n, r, typename is_simd_comparable<I, R>::type{});
+}
+
 template <typename I, typename N>
 // requires: I is ForwardIterator
 // requires: N is integral
@@ -196,7 +495,7 @@ template <typename I, typename N>
 inline
 bool is_sorted_n(I first, N n) {
     typedef typename std::iterator_traits<I>::value_type T;
-    return is_sorted_n(first, n, std::less<T>{});
+    return ::is_sorted_n(first, n, std::less<T>{});
 }
 
 template <typename R, typename T>
@@ -298,3 +597,91 @@ I upper_bound(I first, I last, const typename std::iterator_traits<I>::value_typ
     // precondition: is_sorted(first, last, r)    
     return upper_bound_n(first, distance(first, last), a);
 }
+
+template <typename I, typename R>
+// requires: I is ForwardIterator
+// requires: R is WeakStrictOrdering on the value type of I
+inline
+I lower_bound_hint(I first, I last, I hint, const typename std::iterator_traits<I>::value_type& a, R r) {
+    // precondition: is_sorted(first, last, r) and hint is in [first, last]
+    // precondition: if I is not bidirectional, no element before hint is
+    //               ordered after a
+    // lower_bound in O(log d) comparisons, d the distance from hint to the result
+    typedef typename std::iterator_traits<I>::value_type T;
+    return partition_point_hint(first, last, hint, lower_bound_predicate<R, T>{ r, a });
+}
+
+template <typename I>
+// requires: I is ForwardIterator
+inline
+I lower_bound_hint(I first, I last, I hint, const typename std::iterator_traits<I>::value_type& a) {
+    typedef typename std::iterator_traits<I>::value_type T;
+    return lower_bound_hint(first, last, hint, a, std::less<T>{});
+}
+
+template <typename I, typename R>
+// requires: I is ForwardIterator
+// requires: R is WeakStrictOrdering on the value type of I
+inline
+I upper_bound_hint(I first, I last, I hint, const typename std::iterator_traits<I>::value_type& a, R r) {
+    // precondition: is_sorted(first, last, r) and hint is in [first, last]
+    // precondition: if I is not bidirectional, no element before hint is
+    //               ordered after a
+    // upper_bound in O(log d) comparisons, d the distance from hint to the result
+    typedef typename std::iterator_traits<I>::value_type T;
+    return partition_point_hint(first, last, hint, upper_bound_predicate<R, T>{ r, a });
+}
+
+template <typename I>
+// requires: I is ForwardIterator
+inline
+I upper_bound_hint(I first, I last, I hint, const typename std::iterator_traits<I>::value_type& a) {
+    typedef typename std::iterator_traits<I>::value_type T;
+    return upper_bound_hint(first, last, hint, a, std::less<T>{});
+}
+
+struct binary_searcher
+{
+    // how the in-place merges find where an element of one side goes in
+    // the other: by bisecting the whole side
+    template <typename I, typename N, typename R>
+    I lower_bound_n(I first, N n, const typename std::iterator_traits<I>::value_type& a, R r) const {
+        return ::lower_bound_n(first, n, a, r);
+    }
+
+    template <typename I, typename N, typename R>
+    I upper_bound_n(I first, N n, const typename std::iterator_traits<I>::value_type& a, R r) const {
+        return ::upper_bound_n(first, n, a, r);
+    }
+};
+
+struct galloping_searcher
+{
+    // by galloping from the end of the side next to the element: the
+    // lower bound in the side after it from the front, the upper bound in
+    // the side before it from the back. When the sides are nearly in order
+    // already, the result is a few elements from there
+    template <typename I, typename N, typename R>
+    I lower_bound_n(I first, N n, const typename std::iterator_traits<I>::value_type& a, R r) const {
+        typedef typename std::iterator_traits<I>::value_type T;
+        return partition_point_gallop_n(first, n, lower_bound_predicate<R, T>{ r, a });
+    }
+
+    template <typename I, typename N, typename R>
+    I upper_bound_n(I first, N n, const typename std::iterator_traits<I>::value_type& a, R r,
+                    std::forward_iterator_tag) const {
+        return ::upper_bound_n(first, n, a, r);
+    }
+
+    template <typename I, typename N, typename R>
+    I upper_bound_n(I first, N n, const typename std::iterator_traits<I>::value_type& a, R r,
+                    std::bidirectional_iterator_tag) const {
+        typedef typename std::iterator_traits<I>::value_type T;
+        return partition_point_gallop_backward_n(std::next(first, n), n, upper_bound_predicate<R, T>{ r, a });
+    }
+
+    template <typename I, typename N, typename R>
+    I upper_bound_n(I first, N n, const typename std::iterator_traits<I>::value_type& a, R r) const {
+        return upper_bound_n(first, n, a, r, typename std::iterator_traits<I>::iterator_category{});
+    }
+};
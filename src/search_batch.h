@@ -0,0 +1,203 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include "search.h"
+
+// Looking up many values in one sorted range. A binary search is a chain
+// of dependent loads, so searching for one value after another waits for
+// each cache miss in turn; advancing a group of searches together keeps
+// a miss of every search in flight at once
+
+// the number of searches advanced together
+const std::size_t SEARCH_BATCH_GROUP = 32;
+
+// sorted queries at least this dense (one per this many elements) are
+// answered by a linear sweep; a sequential read of the range is cheaper
+// than the cache misses of searching it
+const std::size_t SEARCH_BATCH_SWEEP = 128;
+
+template <typename I>
+// requires: I is RandomAccessIterator
+inline
+void prefetch_element(I i) {
+#if defined(__GNUC__)
+    __builtin_prefetch(std::addressof(*i));
+#else
+    (void)i;
+#endif
+}
+
+template <typename I, typename N, typename Q, typename O, typename R>
+// requires: I is RandomAccessIterator
+// requires: N is Integral
+// requires: Q is ForwardIterator with the value type of I
+// requires: O is OutputIterator taking I
+// requires: R is StrictWeakOrdering on the value type of I
+O lower_bound_group_n(I first, N n, Q queries, std::size_t m, O result, R r) {
+    // precondition: is_sorted_n(first, n, r) && m <= SEARCH_BATCH_GROUP
+    // m binary searches in lock step. Every search has the same number of
+    // steps and the same halving lengths, so one loop over the group
+    // does a step of each: a load, a comparison and a conditional add,
+    // with the load of the next step prefetched
+    typedef typename std::iterator_traits<I>::value_type T;
+    const T* q[SEARCH_BATCH_GROUP];
+    N position[SEARCH_BATCH_GROUP];
+    for (std::size_t g = 0; g < m; ++g) {
+        q[g] = std::addressof(*queries);
+        ++queries;
+        position[g] = N(0);
+    }
+    if (n) {
+        while (n > N(1)) {
+            N half = n >> 1;
+            n -= half;
+            N next = n >> 1;
+            for (std::size_t g = 0; g < m; ++g) {
+                position[g] += r(first[position[g] + half], *q[g]) ? half : N(0);
+                prefetch_element(first + (position[g] + next));
+            }
+        }
+        for (std::size_t g = 0; g < m; ++g)
+            position[g] += r(first[position[g]], *q[g]) ? N(1) : N(0);
+    }
+    for (std::size_t g = 0; g < m; ++g) {
+        *result = first + position[g];
+        ++result;
+    }
+    return result;
+}
+
+template <typename I, typename N, typename Q, typename O, typename R>
+// requires: I is RandomAccessIterator
+// requires: N is Integral
+// requires: Q is ForwardIterator with the value type of I
+// requires: O is OutputIterator taking I
+// requires: R is StrictWeakOrdering on the value type of I
+O lower_bound_batch_n(I first, N n, Q queries_first, Q queries_last, O result, R r) {
+    // precondition: is_sorted_n(first, n, r)
+    // writes lower_bound_n(first, n, q, r) for each query q, in order
+    while (queries_first != queries_last) {
+        Q group_last = queries_first;
+        std::size_t m = 0;
+        while (m < SEARCH_BATCH_GROUP && group_last != queries_last) {
+            ++group_last;
+            ++m;
+        }
+        result = lower_bound_group_n(first, n, queries_first, m, result, r);
+        queries_first = group_last;
+    }
+    return result;
+}
+
+template <typename I, typename N, typename Q, typename O>
+// requires: I is RandomAccessIterator with a TotallyOrdered value type
+// requires: N is Integral
+// requires: Q is ForwardIterator with the value type of I
+// requires: O is OutputIterator taking I
+inline
+O lower_bound_batch_n(I first, N n, Q queries_first, Q queries_last, O result) {
+    // precondition: is_sorted_n(first, n)
+    typedef typename std::iterator_traits<I>::value_type T;
+    return lower_bound_batch_n(first, n, queries_first, queries_last, result, std::less<T>{});
+}
+
+template <typename I, typename Q, typename O, typename R>
+// requires: I is ForwardIterator
+// requires: Q is InputIterator with the value type of I
+// requires: O is OutputIterator taking I
+// requires: R is StrictWeakOrdering on the value type of I
+O lower_bound_sorted_batch(I first, I last, Q queries_first, Q queries_last, O result, R r) {
+    // precondition: is_sorted(first, last, r) && is_sorted(queries_first, queries_last, r)
+    // each search starts where the previous one ended, walking there one
+    // element at a time
+    while (queries_first != queries_last) {
+        while (first != last && r(*first, *queries_first)) ++first;
+        *result = first;
+        ++result;
+        ++queries_first;
+    }
+    return result;
+}
+
+template <typename I, typename N, typename Q, typename O, typename R>
+// requires: I is ForwardIterator
+// requires: N is Integral
+// requires: Q is InputIterator with the value type of I
+// requires: O is OutputIterator taking I
+// requires: R is StrictWeakOrdering on the value type of I
+O lower_bound_sorted_batch_gallop_n(I first, N n, Q queries_first, Q queries_last, O result, R r) {
+    // precondition: is_sorted_n(first, n, r) && is_sorted(queries_first, queries_last, r)
+    // each search gallops from where the previous one ended, so m queries
+    // cost O(m log(n / m)) comparisons
+    typedef typename std::iterator_traits<I>::value_type T;
+    while (queries_first != queries_last) {
+        I p = partition_point_gallop_n(first, n, lower_bound_predicate<R, T>{ r, *queries_first });
+        n -= N(std::distance(first, p));
+        first = p;
+        *result = first;
+        ++result;
+        ++queries_first;
+    }
+    return result;
+}
+
+template <typename I, typename N, typename Q, typename O, typename R>
+// requires: I is ForwardIterator
+// requires: N is Integral
+// requires: Q is ForwardIterator with the value type of I
+// requires: O is OutputIterator taking I
+// requires: R is StrictWeakOrdering on the value type of I
+inline
+O lower_bound_sparse_batch_n(I first, N n, Q queries_first, Q queries_last, O result, R r,
+                             std::forward_iterator_tag) {
+    return lower_bound_sorted_batch_gallop_n(first, n, queries_first, queries_last, result, r);
+}
+
+template <typename I, typename N, typename Q, typename O, typename R>
+// requires: I is RandomAccessIterator
+// requires: N is Integral
+// requires: Q is ForwardIterator with the value type of I
+// requires: O is OutputIterator taking I
+// requires: R is StrictWeakOrdering on the value type of I
+inline
+O lower_bound_sparse_batch_n(I first, N n, Q queries_first, Q queries_last, O result, R r,
+                             std::random_access_iterator_tag) {
+    // the probes of a gallop depend on each other, so once the queries are
+    // far apart independent searches in lock step are faster
+    return lower_bound_batch_n(first, n, queries_first, queries_last, result, r);
+}
+
+template <typename I, typename N, typename Q, typename O, typename R>
+// requires: I is ForwardIterator
+// requires: N is Integral
+// requires: Q is ForwardIterator with the value type of I
+// requires: O is OutputIterator taking I
+// requires: R is StrictWeakOrdering on the value type of I
+O lower_bound_sorted_batch_n(I first, N n, Q queries_first, Q queries_last, O result, R r) {
+    // precondition: is_sorted_n(first, n, r) && is_sorted(queries_first, queries_last, r)
+    // a linear sweep when the queries are dense; otherwise searches in
+    // lock step, or galloping when I is not random access
+    typedef typename std::iterator_traits<Q>::difference_type M;
+    M m = std::distance(queries_first, queries_last);
+    if (std::size_t(n) <= std::size_t(m) * SEARCH_BATCH_SWEEP) {
+        I last = first;
+        ::advance(last, n);
+        return lower_bound_sorted_batch(first, last, queries_first, queries_last, result, r);
+    }
+    return lower_bound_sparse_batch_n(first, n, queries_first, queries_last, result, r,
+                                      typename std::iterator_traits<I>::iterator_category{});
+}
+
+template <typename I, typename N, typename Q, typename O>
+// requires: I is ForwardIterator with a TotallyOrdered value type
+// requires: N is Integral
+// requires: Q is ForwardIterator with the value type of I
+// requires: O is OutputIterator taking I
+inline
+O lower_bound_sorted_batch_n(I first, N n, Q queries_first, Q queries_last, O result) {
+    // precondition: is_sorted_n(first, n) && is_sorted(queries_first, queries_last)
+    typedef typename std::iterator_traits<I>::value_type T;
+    return lower_bound_sorted_batch_n(first, n, queries_first, queries_last, result, std::less<T>{});
+}
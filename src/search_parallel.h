@@ -0,0 +1,151 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include "search.h"
+#include "thread_pool.h"
+
+// Scans for the first element with some property, split across threads.
+// Every thread walks its part of the range a block at a time and records
+// a match in a shared bound, the position of the first match found so
+// far; a thread stops at the first of its blocks that starts past the
+// bound, since nothing it could find there would come first
+
+// the elements a thread scans between looks at the bound
+const std::size_t PARALLEL_FIND_BLOCK = std::size_t(1) << 14;
+
+template <typename N>
+// requires: N is Integral
+inline
+void atomic_min(std::atomic<N>& a, N x) {
+    N y = a.load(std::memory_order_relaxed);
+    while (x < y && !a.compare_exchange_weak(y, x, std::memory_order_relaxed)) {}
+}
+
+template <typename I, typename N, typename F>
+// requires: I is RandomAccessIterator
+// requires: N is Integral
+// requires: F is a function from (I, N) to N
+N find_first_parallel_n(I first, N n, F find_block, thread_pool& pool) {
+    // find_block(f, m) returns the position in [f, m) of the first match,
+    // or m if there is none; returns the position of the first match in
+    // [first, n), or n. The first block is scanned before any task is
+    // started, so a match near the start costs no more than a sequential
+    // scan. The other blocks are dealt out to a few tasks per thread in
+    // contiguous runs, so each task reads memory sequentially
+    const N block = N(PARALLEL_FIND_BLOCK);
+    if (n <= block) return find_block(first, n);
+    N i = find_block(first, block);
+    if (i != block) return i;
+    N blocks = (n - N(1)) / block;
+    N tasks = std::min(blocks, N(4 * pool.size()));
+    std::atomic<N> bound{ n };
+    parallel_for(pool, N(0), tasks, [&](N t) {
+        N b_last = (t + N(1)) * blocks / tasks + N(1);
+        for (N b = t * blocks / tasks + N(1); b < b_last; ++b) {
+            N lo = b * block;
+            if (lo >= bound.load(std::memory_order_relaxed)) return;
+            N m = std::min(block, n - lo);
+            N j = find_block(first + lo, m);
+            if (j != m) {
+                atomic_min(bound, lo + j);
+                return;
+            }
+        }
+    });
+    return bound.load();
+}
+
+template <typename I, typename N, typename P>
+// requires: I is RandomAccessIterator
+// requires: N is Integral
+// requires: P is UnaryPredicate on the value type of I
+std::pair<I, N> find_if_n_parallel(I first, N n, P pred, thread_pool& pool) {
+    // the same result as find_if_n
+    N i = find_first_parallel_n(first, n, [&](I f, N m) {
+        return m - ::find_if_n(f, m, pred).second;
+    }, pool);
+    return std::make_pair(first + i, n - i);
+}
+
+template <typename I, typename P>
+// requires: I is RandomAccessIterator
+// requires: P is UnaryPredicate on the value type of I
+inline
+I find_if_parallel(I first, I last, P pred, thread_pool& pool) {
+    return find_if_n_parallel(first, last - first, pred, pool).first;
+}
+
+template <typename I, typename N, typename P>
+// requires: I is RandomAccessIterator
+// requires: N is Integral
+// requires: P is UnaryPredicate on the value type of I
+std::pair<I, N> find_if_not_n_parallel(I first, N n, P pred, thread_pool& pool) {
+    // the same result as find_if_not_n
+    N i = find_first_parallel_n(first, n, [&](I f, N m) {
+        return m - ::find_if_not_n(f, m, pred).second;
+    }, pool);
+    return std::make_pair(first + i, n - i);
+}
+
+template <typename I, typename P>
+// requires: I is RandomAccessIterator
+// requires: P is UnaryPredicate on the value type of I
+inline
+I find_if_not_parallel(I first, I last, P pred, thread_pool& pool) {
+    return find_if_not_n_parallel(first, last - first, pred, pool).first;
+}
+
+template <typename I, typename P>
+// requires: I is RandomAccessIterator
+// requires: P is UnaryPredicate on the value type of I
+inline
+bool is_partitioned_parallel(I first, I last, P pred, thread_pool& pool) {
+    // the second scan starts where the first stopped, so each element is
+    // read once
+    I middle = find_if_not_parallel(first, last, pred, pool);
+    return find_if_parallel(middle, last, pred, pool) == last;
+}
+
+template <typename I, typename N, typename R>
+// requires: I is RandomAccessIterator
+// requires: N is Integral
+// requires: R is WeakStrictOrdering on the value type of I
+bool is_sorted_n_parallel(I first, N n, R r, thread_pool& pool) {
+    // a block is checked together with the element before it. A block
+    // out of order counts as a match at its start: only whether there is
+    // one matters, not where
+    N i = find_first_parallel_n(first, n, [&](I f, N m) {
+        bool sorted = f == first ? ::is_sorted_n(f, m, r) : ::is_sorted_n(f - 1, m + N(1), r);
+        return sorted ? m : N(0);
+    }, pool);
+    return i == n;
+}
+
+template <typename I, typename N>
+// requires: I is RandomAccessIterator with a totally ordered value type
+// requires: N is Integral
+inline
+bool is_sorted_n_parallel(I first, N n, thread_pool& pool) {
+    typedef typename std::iterator_traits<I>::value_type T;
+    return is_sorted_n_parallel(first, n, std::less<T>{}, pool);
+}
+
+template <typename I, typename R>
+// requires: I is RandomAccessIterator
+// requires: R is WeakStrictOrdering on the value type of I
+inline
+bool is_sorted_parallel(I first, I last, R r, thread_pool& pool) {
+    return is_sorted_n_parallel(first, last - first, r, pool);
+}
+
+template <typename I>
+// requires: I is RandomAccessIterator with a totally ordered value type
+inline
+bool is_sorted_parallel(I first, I last, thread_pool& pool) {
+    typedef typename std::iterator_traits<I>::value_type T;
+    return is_sorted_n_parallel(first, last - first, std::less<T>{}, pool);
+}
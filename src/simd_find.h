@@ -0,0 +1,345 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <type_traits>
+#include "move.h"
+#include "simd_sort.h"
+
+// Scans of contiguous arrays of numbers with a predicate that compares
+// each element to constants. A vector of elements is compared at a time,
+// a block of vectors costs one branch, and the position of the first
+// match in the block comes from the trailing zeros of the comparison mask
+
+// the number of vectors tested per branch
+const std::size_t SIMD_FIND_UNROLL = 4;
+
+template <typename R, typename T>
+// requires: R is a Relation on T
+// requires: T is Regular
+class compare_to_value
+{
+    // holds for the elements x with r(x, a)
+private:
+    R r;
+    T a;
+public:
+    compare_to_value(const R& r, const T& a) : r{ r }, a{ a } {}
+    bool operator()(const T& x) const { return r(x, a); }
+    const T& value() const { return a; }
+};
+
+template <typename T>
+// requires: T is TotallyOrdered
+class in_range
+{
+    // holds for the elements x with lo <= x < hi
+private:
+    T lo;
+    T hi;
+public:
+    in_range(const T& lo, const T& hi) : lo{ lo }, hi{ hi } {}
+    bool operator()(const T& x) const { return lo <= x && x < hi; }
+    const T& lower() const { return lo; }
+    const T& upper() const { return hi; }
+};
+
+template <typename T>
+struct is_simd_number
+{
+    // the element types of the vectors: integers other than bool, float and double
+    static const bool value =
+        (std::is_integral<T>::value && !std::is_same<T, bool>::value) ||
+        std::is_same<T, float>::value || std::is_same<T, double>::value;
+};
+
+template <typename R>
+struct simd_relation
+{
+    // the relations that have a vector form
+    static const bool value = false;
+};
+
+template <typename P, typename T>
+struct simd_predicate
+{
+    // the predicates on T that have a vector form
+    static const bool value = false;
+};
+
+template <typename I, typename P>
+// requires: I is Iterator
+// requires: P is UnaryPredicate on the value type of I
+struct is_simd_findable
+{
+    typedef typename std::iterator_traits<I>::value_type T;
+    static const bool value =
+#if defined(__GNUC__)
+        is_contiguous_iterator<I>::value && is_simd_number<T>::value &&
+        simd_predicate<P, T>::value;
+#else
+        false;
+#endif
+    typedef std::integral_constant<bool, value> type;
+};
+
+template <typename I, typename R>
+// requires: I is Iterator
+// requires: R is StrictWeakOrdering on the value type of I
+struct is_simd_comparable
+{
+    // is_sorted compares neighbours with a vector of each
+    typedef typename std::iterator_traits<I>::value_type T;
+    static const bool value =
+#if defined(__GNUC__)
+        is_contiguous_iterator<I>::value && is_simd_number<T>::value &&
+        std::is_same<R, std::less<T>>::value;
+#else
+        false;
+#endif
+    typedef std::integral_constant<bool, value> type;
+};
+
+#if defined(__GNUC__)
+
+template <typename T>
+struct simd_relation<std::less<T>>
+{
+    static const bool value = true;
+    template <typename V, typename M>
+    static inline __attribute__((always_inline))
+    void apply(const V& x, const V& y, M& m) { m = x < y; }
+};
+
+template <typename T>
+struct simd_relation<std::less_equal<T>>
+{
+    static const bool value = true;
+    template <typename V, typename M>
+    static inline __attribute__((always_inline))
+    void apply(const V& x, const V& y, M& m) { m = x <= y; }
+};
+
+template <typename T>
+struct simd_relation<std::greater<T>>
+{
+    static const bool value = true;
+    template <typename V, typename M>
+    static inline __attribute__((always_inline))
+    void apply(const V& x, const V& y, M& m) { m = x > y; }
+};
+
+template <typename T>
+struct simd_relation<std::greater_equal<T>>
+{
+    static const bool value = true;
+    template <typename V, typename M>
+    static inline __attribute__((always_inline))
+    void apply(const V& x, const V& y, M& m) { m = x >= y; }
+};
+
+template <typename T>
+struct simd_relation<std::equal_to<T>>
+{
+    static const bool value = true;
+    template <typename V, typename M>
+    static inline __attribute__((always_inline))
+    void apply(const V& x, const V& y, M& m) { m = x == y; }
+};
+
+template <typename T>
+struct simd_relation<std::not_equal_to<T>>
+{
+    static const bool value = true;
+    template <typename V, typename M>
+    static inline __attribute__((always_inline))
+    void apply(const V& x, const V& y, M& m) { m = x != y; }
+};
+
+template <typename R, typename T>
+struct simd_predicate<compare_to_value<R, T>, T>
+{
+    static const bool value = simd_relation<R>::value;
+    template <typename V, typename M>
+    static inline __attribute__((always_inline))
+    void mask(const compare_to_value<R, T>& p, const V& x, M& m) {
+        V a = V{} + p.value();
+        simd_relation<R>::apply(x, a, m);
+    }
+};
+
+template <typename T>
+struct simd_predicate<in_range<T>, T>
+{
+    static const bool value = true;
+    template <typename V, typename M>
+    static inline __attribute__((always_inline))
+    void mask(const in_range<T>& p, const V& x, M& m) {
+        V lo = V{} + p.lower();
+        V hi = V{} + p.upper();
+        m = (lo <= x) & (x < hi);
+    }
+};
+
+template <typename M>
+inline __attribute__((always_inline))
+bool simd_any(const M& m) {
+    std::uint64_t w[sizeof(M) / 8];
+    std::memcpy(w, &m, sizeof(M));
+    std::uint64_t x = 0;
+    for (std::size_t i = 0; i < sizeof(M) / 8; ++i) x |= w[i];
+    return x != 0;
+}
+
+template <typename M>
+inline __attribute__((always_inline))
+std::size_t simd_first_lane(const M& m) {
+    // precondition: simd_any(m)
+    // every lane of a comparison mask is all ones or all zeros, so the
+    // trailing zero bytes of the first non-zero word count the lanes before it
+    std::uint64_t w[sizeof(M) / 8];
+    std::memcpy(w, &m, sizeof(M));
+    std::size_t i = 0;
+    while (!w[i]) ++i;
+    return (8 * i + std::size_t(__builtin_ctzll(w[i])) / 8) / sizeof(m[0]);
+}
+
+template <bool Match, typename T, typename P>
+// requires: T is a simd number
+// requires: simd_predicate<P, T>::value
+inline __attribute__((always_inline))
+const T* find_simd_body(const T* first, const T* last, P pred) {
+    // the first element for which pred is Match, or last
+    typedef typename simd_vector<T>::type V;
+    typedef decltype(V{} < V{}) M;
+    const std::size_t L = simd_vector<T>::lanes;
+    const std::size_t B = L * SIMD_FIND_UNROLL;
+    while (std::size_t(last - first) >= B) {
+        M m[SIMD_FIND_UNROLL];
+        M any = M{};
+        for (std::size_t u = 0; u < SIMD_FIND_UNROLL; ++u) {
+            V x;
+            std::memcpy(&x, first + u * L, sizeof(V));
+            simd_predicate<P, T>::mask(pred, x, m[u]);
+            if (!Match) m[u] = ~m[u];
+            any |= m[u];
+        }
+        if (simd_any(any)) {
+            std::size_t u = 0;
+            while (!simd_any(m[u])) ++u;
+            return first + u * L + simd_first_lane(m[u]);
+        }
+        first += B;
+    }
+    while (first != last && pred(*first) != Match) ++first;
+    return first;
+}
+
+template <typename T>
+// requires: T is a simd number
+inline __attribute__((always_inline))
+const T* is_sorted_until_simd_body(const T* first, const T* last) {
+    // the first element less than the one before it, or last; each
+    // vector is compared with the same vector shifted by one element
+    typedef typename simd_vector<T>::type V;
+    typedef decltype(V{} < V{}) M;
+    const std::size_t L = simd_vector<T>::lanes;
+    const std::size_t B = L * SIMD_FIND_UNROLL;
+    if (first == last) return last;
+    const T* previous = first;
+    ++first;
+    while (std::size_t(last - first) >= B) {
+        M m[SIMD_FIND_UNROLL];
+        M any = M{};
+        for (std::size_t u = 0; u < SIMD_FIND_UNROLL; ++u) {
+            V x;
+            V y;
+            std::memcpy(&x, previous + u * L, sizeof(V));
+            std::memcpy(&y, first + u * L, sizeof(V));
+            m[u] = y < x;
+            any |= m[u];
+        }
+        if (simd_any(any)) {
+            std::size_t u = 0;
+            while (!simd_any(m[u])) ++u;
+            return first + u * L + simd_first_lane(m[u]);
+        }
+        previous += B;
+        first += B;
+    }
+    while (first != last && !(*first < *previous)) {
+        previous = first;
+        ++first;
+    }
+    return first;
+}
+
+template <bool Match, typename T, typename P>
+const T* find_simd_generic(const T* first, const T* last, P pred) {
+    // the vectors of the baseline target (SSE2 on x86-64), or scalar code
+    // where there are none
+    return find_simd_body<Match>(first, last, pred);
+}
+
+template <typename T>
+const T* is_sorted_until_simd_generic(const T* first, const T* last) {
+    return is_sorted_until_simd_body(first, last);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+template <bool Match, typename T, typename P>
+__attribute__((target("avx2")))
+const T* find_simd_avx2(const T* first, const T* last, P pred) {
+    return find_simd_body<Match>(first, last, pred);
+}
+
+template <typename T>
+__attribute__((target("avx2")))
+const T* is_sorted_until_simd_avx2(const T* first, const T* last) {
+    return is_sorted_until_simd_body(first, last);
+}
+
+template <bool Match, typename T, typename P>
+// requires: T is a simd number
+// requires: simd_predicate<P, T>::value
+const T* find_simd(const T* first, const T* last, P pred) {
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    if (avx2)
+        return find_simd_avx2<Match>(first, last, pred);
+    else
+        return find_simd_generic<Match>(first, last, pred);
+}
+
+template <typename T>
+// requires: T is a simd number
+const T* is_sorted_until_simd(const T* first, const T* last) {
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    if (avx2)
+        return is_sorted_until_simd_avx2(first, last);
+    else
+        return is_sorted_until_simd_generic(first, last);
+}
+
+#else
+
+template <bool Match, typename T, typename P>
+// requires: T is a simd number
+// requires: simd_predicate<P, T>::value
+inline
+const T* find_simd(const T* first, const T* last, P pred) {
+    return find_simd_generic<Match>(first, last, pred);
+}
+
+template <typename T>
+// requires: T is a simd number
+inline
+const T* is_sorted_until_simd(const T* first, const T* last) {
+    return is_sorted_until_simd_generic(first, last);
+}
+
+#endif
+
+#endif
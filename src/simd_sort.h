@@ -0,0 +1,184 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include "move.h"
+
+// blocks of at most this many elements are sorted with a vectorized network
+const std::size_t SIMD_SORT_CUTOFF = 64;
+
+template <typename I, typename R>
+// requires: I is Iterator
+// requires: R is StrictWeakOrdering on the value type of I
+struct is_simd_sortable
+{
+    // a sorting network is not stable, so it is only used where equal
+    // elements cannot be told apart: 32 and 64 bit integers with std::less.
+    // Floating point is excluded because -0.0 and 0.0 are equivalent but
+    // distinguishable
+    typedef typename std::iterator_traits<I>::value_type T;
+    static const bool value =
+#if defined(__GNUC__)
+        is_contiguous_iterator<I>::value &&
+        std::is_integral<T>::value && (sizeof(T) == 4 || sizeof(T) == 8) &&
+        std::is_same<R, std::less<T>>::value;
+#else
+        false;
+#endif
+    typedef std::integral_constant<bool, value> type;
+};
+
+#if defined(__GNUC__)
+
+// the width of the vector registers the networks are written for
+const std::size_t SIMD_SORT_BYTES = 32;
+
+template <typename T>
+struct simd_vector
+{
+    typedef T type __attribute__((vector_size(SIMD_SORT_BYTES)));
+    static const std::size_t lanes = SIMD_SORT_BYTES / sizeof(T);
+};
+
+template <typename T>
+// requires: T is a 32 or 64 bit integer
+inline __attribute__((always_inline))
+void bitonic_sort_simd(T* a, std::size_t n) {
+    // precondition: n is a power of 2 and a multiple of simd_vector<T>::lanes
+    // the bitonic network over a, a vector at a time: partners at a distance
+    // of at least a vector are whole vectors, nearer partners are lanes of
+    // the same vector and are brought together with a shuffle. Each
+    // compare-exchange is the vector form of sort_two: a min and a max
+    typedef typename simd_vector<T>::type V;
+    typedef typename std::make_signed<T>::type S;
+    typedef typename simd_vector<S>::type M;
+    const std::size_t L = simd_vector<T>::lanes;
+    M lane;
+    for (std::size_t l = 0; l < L; ++l) lane[l] = S(l);
+    for (std::size_t k = 2; k <= n; k <<= 1) {
+        for (std::size_t j = k >> 1; j > 0; j >>= 1) {
+            for (std::size_t i = 0; i < n; i += L) {
+                V x;
+                std::memcpy(&x, a + i, sizeof(V));
+                if (j >= L) {
+                    if (i & j) continue;
+                    V y;
+                    std::memcpy(&y, a + i + j, sizeof(V));
+                    V lo = x < y ? x : y;
+                    V hi = x < y ? y : x;
+                    if (i & k) std::swap(lo, hi);
+                    std::memcpy(a + i, &lo, sizeof(V));
+                    std::memcpy(a + i + j, &hi, sizeof(V));
+                } else {
+                    V y = __builtin_shuffle(x, lane ^ S(j));
+                    V lo = x < y ? x : y;
+                    V hi = x < y ? y : x;
+                    // a lane keeps the minimum when it is the lower of its
+                    // pair in an ascending block or the upper in a descending one
+                    M lower = (lane & S(j)) == 0;
+                    M ascending = ((lane + S(i)) & S(k)) == 0;
+                    x = lower == ascending ? lo : hi;
+                    std::memcpy(a + i, &x, sizeof(V));
+                }
+            }
+        }
+    }
+}
+
+template <typename T>
+// requires: T is a 32 or 64 bit integer
+inline __attribute__((always_inline))
+void sort_small_simd_body(T* first, std::size_t n) {
+    // precondition: n <= SIMD_SORT_CUTOFF
+    // pads the block with the maximum value up to a power of 2
+    const std::size_t L = simd_vector<T>::lanes;
+    alignas(SIMD_SORT_BYTES) T a[SIMD_SORT_CUTOFF];
+    std::size_t m = L;
+    while (m < n) m <<= 1;
+    std::memcpy(a, first, n * sizeof(T));
+    for (std::size_t i = n; i < m; ++i) a[i] = std::numeric_limits<T>::max();
+    bitonic_sort_simd(a, m);
+    std::memcpy(first, a, n * sizeof(T));
+}
+
+template <typename T>
+void sort_small_simd_generic(T* first, std::size_t n) {
+    // the same network in whatever vectors the baseline target has (SSE2 on
+    // x86-64), or scalar code where there are none
+    sort_small_simd_body(first, n);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+template <typename T>
+__attribute__((target("avx2")))
+void sort_small_simd_avx2(T* first, std::size_t n) {
+    sort_small_simd_body(first, n);
+}
+
+template <typename T>
+// requires: T is a 32 or 64 bit integer
+void sort_small_simd(T* first, std::size_t n) {
+    // precondition: n <= SIMD_SORT_CUTOFF
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    if (avx2)
+        sort_small_simd_avx2(first, n);
+    else
+        sort_small_simd_generic(first, n);
+}
+
+#else
+
+template <typename T>
+// requires: T is a 32 or 64 bit integer
+inline
+void sort_small_simd(T* first, std::size_t n) {
+    // precondition: n <= SIMD_SORT_CUTOFF
+    sort_small_simd_generic(first, n);
+}
+
+#endif
+
+#endif
+
+template <typename I, typename N, typename R>
+// requires: I is ForwardIterator
+// requires: N is Integral
+// requires: R is StrictWeakOrdering on the value type of I
+inline
+bool sort_small_n(I, N, R, std::false_type) {
+    return false;
+}
+
+#if defined(__GNUC__)
+
+template <typename I, typename N, typename R>
+// requires: I is ContiguousIterator
+// requires: N is Integral
+// requires: R is StrictWeakOrdering on the value type of I
+inline
+bool sort_small_n(I first, N n, R, std::true_type) {
+    if (!n) return true;
+    sort_small_simd(std::addressof(*first), std::size_t(n));
+    return true;
+}
+
+#endif
+
+template <typename I, typename N, typename R>
+// requires: I is ForwardIterator
+// requires: N is Integral
+// requires: R is StrictWeakOrdering on the value type of I
+inline
+bool sort_small_n(I first, N n, R r) {
+    // precondition: n <= SIMD_SORT_CUTOFF
+    // sorts [first, n) with a vectorized network and returns true if the
+    // value type and ordering allow one; otherwise does nothing
+    return sort_small_n(first, n, r, typename is_simd_sortable<I, R>::type{});
+}
@@ -0,0 +1,164 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "pdqsort.h"
+
+// Sorting by a key that is expensive to compute: the keys are computed
+// once per element into an array of (key, index) entries, the entries are
+// sorted by any sorting function, and the permutation they describe is
+// applied to the range
+
+template <typename K>
+// requires: K is TotallyOrdered
+struct keyed
+{
+    K key;
+    std::size_t index;
+};
+
+template <typename K>
+// requires: K is TotallyOrdered
+struct keyed_less
+{
+    // ties are broken by the original position, so the result is stable
+    // whatever sort is used on the entries
+    bool operator()(const keyed<K>& x, const keyed<K>& y) const {
+        if (x.key < y.key) return true;
+        if (y.key < x.key) return false;
+        return x.index < y.index;
+    }
+};
+
+struct prefixed
+{
+    std::uint64_t prefix;
+    std::size_t index;
+};
+
+template <typename K>
+// requires: K is TotallyOrdered
+class prefixed_less
+{
+    // compares the prefixes and only looks at the keys, kept in their own
+    // array, when the prefixes are equal
+private:
+    const K* keys;
+public:
+    prefixed_less(const K* keys) : keys{ keys } {}
+    bool operator()(const prefixed& x, const prefixed& y) const {
+        if (x.prefix != y.prefix) return x.prefix < y.prefix;
+        if (keys[x.index] < keys[y.index]) return true;
+        if (keys[y.index] < keys[x.index]) return false;
+        return x.index < y.index;
+    }
+};
+
+struct string_prefix
+{
+    // the first 8 bytes of a string as a big endian integer, padded with
+    // zeros, so that prefixes compare like memcmp of the strings
+    std::uint64_t operator()(const std::string& s) const {
+        unsigned char bytes[8] = {};
+        std::memcpy(bytes, s.data(), s.size() < 8 ? s.size() : 8);
+        std::uint64_t p = 0;
+        for (std::size_t i = 0; i < 8; ++i) p = (p << 8) | bytes[i];
+        return p;
+    }
+};
+
+struct pdqsorter
+{
+    template <typename I, typename R>
+    void operator()(I first, I last, R r) const {
+        pdqsort(first, last, r);
+    }
+};
+
+template <typename I, typename E>
+// requires: I is RandomAccessIterator
+// requires: E is a pointer to keyed or prefixed entries
+void apply_permutation(I first, E entries, std::size_t n) {
+    // precondition: the indices of the entries are a permutation of [0, n)
+    // moves first[entries[i].index] to first[i] for every i by following
+    // the cycles of the permutation; each element is moved once, plus one
+    // extra move per cycle. An entry whose index is its own position is done
+    typedef typename std::iterator_traits<I>::value_type T;
+    typedef typename std::iterator_traits<I>::difference_type N;
+    for (std::size_t i = 0; i < n; ++i) {
+        if (entries[i].index == i) continue;
+        T tmp = std::move(first[N(i)]);
+        std::size_t j = i;
+        std::size_t k = entries[j].index;
+        while (k != i) {
+            first[N(j)] = std::move(first[N(k)]);
+            entries[j].index = j;
+            j = k;
+            k = entries[j].index;
+        }
+        first[N(j)] = std::move(tmp);
+        entries[j].index = j;
+    }
+}
+
+template <typename I, typename F, typename S>
+// requires: I is RandomAccessIterator
+// requires: F is a function from the value type of I to a TotallyOrdered type
+// requires: S sorts a range of keyed entries with a comparison, like pdqsort
+void sort_by_key(I first, I last, F key, S sort) {
+    // stable; key is called once per element
+    typedef typename std::decay<decltype(key(*first))>::type K;
+    std::size_t n = std::size_t(last - first);
+    std::vector<keyed<K>> entries;
+    entries.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) entries.push_back(keyed<K>{ key(first[i]), i });
+    sort(entries.begin(), entries.end(), keyed_less<K>{});
+    apply_permutation(first, entries.data(), n);
+}
+
+template <typename I, typename F>
+// requires: I is RandomAccessIterator
+// requires: F is a function from the value type of I to a TotallyOrdered type
+inline
+void sort_by_key(I first, I last, F key) {
+    sort_by_key(first, last, key, pdqsorter{});
+}
+
+template <typename I, typename F, typename P, typename S>
+// requires: I is RandomAccessIterator
+// requires: F is a function from the value type of I to a TotallyOrdered type K
+// requires: P is a function from K to std::uint64_t such that
+//           prefix(x) < prefix(y) implies x < y, like string_prefix
+// requires: S sorts a range of prefixed entries with a comparison, like pdqsort
+void sort_by_key_prefix(I first, I last, F key, P prefix, S sort) {
+    // stable; key is called once per element. The entries being sorted are
+    // 16 bytes and most comparisons are of two integers; the keys are only
+    // compared when their prefixes are equal
+    typedef typename std::decay<decltype(key(*first))>::type K;
+    std::size_t n = std::size_t(last - first);
+    std::vector<K> keys;
+    keys.reserve(n);
+    std::vector<prefixed> entries;
+    entries.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        keys.push_back(key(first[i]));
+        entries.push_back(prefixed{ prefix(keys.back()), i });
+    }
+    sort(entries.begin(), entries.end(), prefixed_less<K>(keys.data()));
+    apply_permutation(first, entries.data(), n);
+}
+
+template <typename I, typename F, typename P>
+// requires: I is RandomAccessIterator
+// requires: F is a function from the value type of I to a TotallyOrdered type K
+// requires: P is a function from K to std::uint64_t such that
+//           prefix(x) < prefix(y) implies x < y, like string_prefix
+inline
+void sort_by_key_prefix(I first, I last, F key, P prefix) {
+    sort_by_key_prefix(first, last, key, prefix, pdqsorter{});
+}
@@ -0,0 +1,363 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <vector>
+#include "merge.h"
+#include "radix_sort.h"
+#include "thread_pool.h"
+
+// subproblems smaller than this are never split across threads
+const std::size_t PARALLEL_SORT_MIN_GRAIN = std::size_t(1) << 13;
+
+template <typename N>
+// requires: N is Integral
+inline
+N parallel_grain(N n, const thread_pool& pool) {
+    // a few tasks per thread are enough to balance the load
+    N grain = n / N(4 * pool.size());
+    return std::max(grain, N(PARALLEL_SORT_MIN_GRAIN));
+}
+
+template <typename I, typename N, typename R>
+// requires: I is ForwardIterator
+// requires: N is Integral
+// requires: R is WeakStrictOrdering on the value type of I
+void merge_inplace_n_parallel(I f0, N n0, I f1, N n1, R r, thread_pool& pool, N grain) {
+    // precondition: std::distance(f0, f1) == n0
+    // precondition is_sorted_n(f0, n0, r) && is_sorted_n(f1, n1, r)
+    if (!n0 || !n1) return;
+    if (n0 + n1 <= grain) {
+        merge_inplace_n(f0, n0, f1, n1, r);
+        return;
+    }
+    I f0_0, f0_1, f1_0, f1_1;
+    N n0_0, n0_1, n1_0, n1_1;
+    if (n0 < n1)
+        merge_inplace_left_subproblem(f0, n0,
+            f1, n1,
+            f0_0, n0_0,
+            f0_1, n0_1,
+            f1_0, n1_0,
+            f1_1, n1_1,
+            r);
+    else
+        merge_inplace_right_subproblem(f0, n0,
+            f1, n1,
+            f0_0, n0_0,
+            f0_1, n0_1,
+            f1_0, n1_0,
+            f1_1, n1_1,
+            r);
+    pool.invoke([&] { merge_inplace_n_parallel(f0_0, n0_0, f0_1, n0_1, r, pool, grain); },
+                [&] { merge_inplace_n_parallel(f1_0, n1_0, f1_1, n1_1, r, pool, grain); });
+}
+
+template <typename I, typename N, typename R>
+// requires: I is ForwardIterator
+// requires: N is Integral
+// requires: R is WeakStrictOrdering on the value type of I
+I sort_inplace_n_parallel(I first, N n, R r, thread_pool& pool, N grain) {
+    if (n <= grain) return sort_inplace_n(first, n, r);
+    N half = n >> 1;
+    I middle = first;
+    std::advance(middle, half);
+    I last;
+    pool.invoke([&] { sort_inplace_n_parallel(first, half, r, pool, grain); },
+                [&] { last = sort_inplace_n_parallel(middle, n - half, r, pool, grain); });
+    merge_inplace_n_parallel(first, half, middle, n - half, r, pool, grain);
+    return last;
+}
+
+template <typename I, typename R>
+// requires: I is ForwardIterator
+// requires: R is WeakStrictOrdering on the value type of I
+void sort_inplace_parallel(I first, I last, R r, thread_pool& pool) {
+    typedef typename std::iterator_traits<I>::difference_type N;
+    N n = std::distance(first, last);
+    sort_inplace_n_parallel(first, n, r, pool, parallel_grain(n, pool));
+}
+
+template <typename I, typename N, typename R, typename B>
+// requires: I is ForwardIterator
+// requires: N is Integral
+// requires: R is WeakStrictOrdering on the value type of I
+void merge_adaptive_n_parallel(I f0, N n0, I f1, N n1, R r, B buffer, N buffer_size,
+                               thread_pool& pool, N grain) {
+    // precondition: std::distance(f0, f1) == n0
+    // precondition is_sorted_n(f0, n0, r) && is_sorted_n(f1, n1, r)
+    // the two subproblems run on disjoint halves of the buffer
+    if (!n0 || !n1) return;
+    if (n0 + n1 <= grain) {
+        merge_adaptive_n(f0, n0, f1, n1, r, buffer, buffer_size);
+        return;
+    }
+    I f0_0, f0_1, f1_0, f1_1;
+    N n0_0, n0_1, n1_0, n1_1;
+    if (n0 < n1)
+        merge_inplace_left_subproblem(f0, n0,
+            f1, n1,
+            f0_0, n0_0,
+            f0_1, n0_1,
+            f1_0, n1_0,
+            f1_1, n1_1,
+            r, buffered_rotator<B, N>(buffer, buffer_size));
+    else
+        merge_inplace_right_subproblem(f0, n0,
+            f1, n1,
+            f0_0, n0_0,
+            f0_1, n0_1,
+            f1_0, n1_0,
+            f1_1, n1_1,
+            r, buffered_rotator<B, N>(buffer, buffer_size));
+    N half_buffer = buffer_size >> 1;
+    pool.invoke([&] { merge_adaptive_n_parallel(f0_0, n0_0, f0_1, n0_1, r,
+                                                buffer, half_buffer, pool, grain); },
+                [&] { merge_adaptive_n_parallel(f1_0, n1_0, f1_1, n1_1, r,
+                                                buffer + half_buffer, buffer_size - half_buffer, pool, grain); });
+}
+
+template <typename I, typename N, typename R, typename B>
+// requires: I is ForwardIterator
+// requires: N is Integral
+// requires: R is WeakStrictOrdering on the value type of I
+I sort_adaptive_n_parallel(I first, N n, R r, B buffer, N buffer_size, thread_pool& pool, N grain) {
+    if (n <= grain) return sort_adaptive_n(first, n, r, buffer, buffer_size);
+    N half = n >> 1;
+    N half_buffer = buffer_size >> 1;
+    I middle = first;
+    std::advance(middle, half);
+    I last;
+    pool.invoke([&] { sort_adaptive_n_parallel(first, half, r,
+                                               buffer, half_buffer, pool, grain); },
+                [&] { last = sort_adaptive_n_parallel(middle, n - half, r,
+                                                      buffer + half_buffer, buffer_size - half_buffer, pool, grain); });
+    merge_adaptive_n_parallel(first, half, middle, n - half, r, buffer, buffer_size, pool, grain);
+    return last;
+}
+
+template <typename I, typename R>
+// requires: I is ForwardIterator
+// requires: R is WeakStrictOrdering on the value type of I
+void sort_adaptive_parallel(I first, I last, R r,
+                            typename std::iterator_traits<I>::difference_type buffer_size,
+                            thread_pool& pool) {
+    // stable; the buffer budget is the same as for sort_adaptive
+    typedef typename std::iterator_traits<I>::value_type T;
+    typedef typename std::iterator_traits<I>::difference_type N;
+    N n = std::distance(first, last);
+    buffer_size = std::max(N(0), std::min(buffer_size, N(n >> 1)));
+    temporary_buffer<T> buffer(buffer_size);
+    sort_adaptive_n_parallel(first, n, r, buffer.begin(), buffer_size, pool, parallel_grain(n, pool));
+}
+
+template <typename I0, typename I1, typename N, typename R>
+// requires: I0 and I1 are RandomAccessIterators with the same value type
+// requires: N is Integral
+// requires: R is WeakStrictOrdering on the value type of I0
+N merge_path_corank(I0 f0, N n0, I1 f1, N n1, N k, R r) {
+    // precondition: 0 <= k <= n0 + n1
+    // returns how many of the first k elements of the stable merge of
+    // [f0, n0) and [f1, n1) come from [f0, n0): a binary search along the
+    // k-th diagonal of the merge path for the first i with f1[k - i - 1] < f0[i]
+    N first = k > n1 ? k - n1 : N(0);
+    N n = std::min(k, n0) - first;
+    while (n) {
+        N half = n >> 1;
+        N i = first + half;
+        if (!r(f1[k - i - 1], f0[i])) {
+            first = i + 1;
+            n -= half + 1;
+        } else {
+            n = half;
+        }
+    }
+    return first;
+}
+
+template <typename N>
+// requires: N is Integral
+inline
+N merge_path_segments(N n, const thread_pool& pool) {
+    N segments = n / N(PARALLEL_SORT_MIN_GRAIN);
+    return std::max(N(1), std::min(segments, N(4 * pool.size())));
+}
+
+template <typename I0, typename I1, typename O, typename R>
+// requires: I0 and I1 are RandomAccessIterators with the same value type
+// requires: O is RandomAccessIterator
+// requires: R is WeakStrictOrdering on the value type of I0
+O merge_parallel(I0 f0, I0 l0, I1 f1, I1 l1, O result, R r, thread_pool& pool) {
+    // precondition: the output range does not overlap the inputs
+    // the output is cut into equal segments that are merged independently
+    typedef typename std::iterator_traits<O>::difference_type N;
+    N n0 = l0 - f0;
+    N n1 = l1 - f1;
+    N n = n0 + n1;
+    N p = merge_path_segments(n, pool);
+    parallel_for(pool, N(0), p, [&](N s) {
+        N k0 = n * s / p;
+        N k1 = n * (s + 1) / p;
+        N i0 = merge_path_corank(f0, n0, f1, n1, k0, r);
+        N i1 = merge_path_corank(f0, n0, f1, n1, k1, r);
+        std::merge(f0 + i0, f0 + i1, f1 + (k0 - i0), f1 + (k1 - i1), result + k0, r);
+    });
+    return result + n;
+}
+
+template <typename I, typename R, typename B>
+// requires: I is RandomAccessIterator
+// requires: B is a pointer to the value type of I
+// requires: R is StrictWeakOrdering on the value type of I
+void merge_with_buffer_parallel(I first, I middle, I last, R r, B buffer, thread_pool& pool) {
+    // precondition: the buffer is uninitialized storage for at least
+    //               middle - first elements
+    // the left half is moved to the buffer in parallel and the output cut
+    // into segments along the merge path; the right half's part of every
+    // segment is moved, left to right, to the end of that segment, after
+    // which the segments are disjoint and are merged from the buffer in
+    // parallel. That move stays serial: a segment's destination overlaps
+    // the sources of the segments before it
+    typedef typename std::iterator_traits<I>::difference_type N;
+    N n0 = middle - first;
+    N n1 = last - middle;
+    N n = n0 + n1;
+    N p = merge_path_segments(n, pool);
+    if (p == 1) {
+        merge_with_buffer(first, middle, last, r, buffer);
+        return;
+    }
+    parallel_for(pool, N(0), p, [&](N s) {
+        ::uninitialized_move(first + n0 * s / p, first + n0 * (s + 1) / p, buffer + n0 * s / p);
+    });
+    B buffer_last = buffer + n0;
+    destroy_guard<typename std::iterator_traits<B>::value_type> guard(buffer, buffer_last);
+    std::vector<N> corank(p + 1);
+    parallel_for(pool, N(0), p + 1, [&](N s) {
+        corank[s] = merge_path_corank(buffer, n0, middle, n1, n * s / p, r);
+    });
+    for (N s = 0; s < p; ++s) {
+        N j0 = n * s / p - corank[s];
+        N j1 = n * (s + 1) / p - corank[s + 1];
+        if (corank[s + 1] != n0)
+            std::move(middle + j0, middle + j1, first + corank[s + 1] + j0);
+    }
+    parallel_for(pool, N(0), p, [&](N s) {
+        N k0 = n * s / p;
+        N k1 = n * (s + 1) / p;
+        N i0 = corank[s];
+        N i1 = corank[s + 1];
+        merge_from_buffer(buffer + i0, buffer + i1, first + (i1 + k0 - i0), first + k1, first + k0, r);
+    });
+}
+
+template <typename I, typename N, typename R, typename B>
+// requires: I is RandomAccessIterator
+// requires: N is Integral
+// requires: R is WeakStrictOrdering on the value type of I
+I sort_inplace_n_with_buffer_parallel(I first, N n, R r, B buffer, thread_pool& pool, N grain) {
+    // precondition: the buffer holds at least n / 2 elements
+    if (n <= grain) return sort_inplace_n_with_buffer(first, n, r, buffer);
+    N half = n >> 1;
+    I middle = first + half;
+    I last = first + n;
+    pool.invoke([&] { sort_inplace_n_with_buffer_parallel(first, half, r, buffer, pool, grain); },
+                [&] { sort_inplace_n_with_buffer_parallel(middle, n - half, r, buffer + (half >> 1), pool, grain); });
+    merge_with_buffer_parallel(first, middle, last, r, buffer, pool);
+    return last;
+}
+
+template <typename I, typename R>
+// requires: I is RandomAccessIterator
+// requires: R is WeakStrictOrdering on the value type of I
+void sort_inplace_with_buffer_parallel(I first, I last, R r, thread_pool& pool) {
+    typedef typename std::iterator_traits<I>::value_type T;
+    typedef typename std::iterator_traits<I>::difference_type N;
+    N n = last - first;
+    temporary_buffer<T> buffer(n >> 1);
+    sort_inplace_n_with_buffer_parallel(first, n, r, buffer.begin(), pool, parallel_grain(n, pool));
+}
+
+template <typename I, typename K>
+// requires: I is RandomAccessIterator
+// requires: K is a key function on the value type of I
+void radix_sort_lsd_parallel(I first, I last, K key, thread_pool& pool) {
+    // radix_sort_lsd with the range cut into chunks: every pass counts the
+    // digit of each chunk in parallel, gives each chunk its own offsets in
+    // every bucket, in chunk order so the sort stays stable, and scatters
+    // the chunks in parallel
+    typedef typename std::iterator_traits<I>::value_type T;
+    typedef typename std::iterator_traits<I>::difference_type N;
+    const std::size_t D = radix_key_type<I, K>::digits;
+    N n = last - first;
+    N grain = parallel_grain(n, pool);
+    if (n <= grain) {
+        radix_sort_lsd(first, last, key);
+        return;
+    }
+    std::size_t chunks = std::size_t((n + grain - 1) / grain);
+    auto chunk_first = [&](std::size_t c) { return N(c) * grain; };
+    auto chunk_last = [&](std::size_t c) { return std::min(n, N(c + 1) * grain); };
+
+    temporary_buffer<T> buffer(n);
+    T* buffer_last = ::uninitialized_move(first, last, buffer.begin());
+    destroy_guard<T> guard(buffer.begin(), buffer_last);
+    T* b = buffer.begin();
+
+    std::vector<std::size_t> counts(chunks * D * RADIX_BUCKETS);
+    parallel_for(pool, std::size_t(0), chunks, [&](std::size_t c) {
+        radix_histograms(b + chunk_first(c), b + chunk_last(c), key, &counts[c * D * RADIX_BUCKETS]);
+    });
+    std::vector<std::size_t> offsets(chunks * RADIX_BUCKETS);
+    bool in_buffer = true;
+    bool first_pass = true;
+    for (std::size_t d = 0; d < D; ++d) {
+        std::size_t shift = d * RADIX_BITS;
+        std::size_t total[RADIX_BUCKETS] = {};
+        for (std::size_t c = 0; c < chunks; ++c)
+            for (std::size_t k = 0; k < RADIX_BUCKETS; ++k)
+                total[k] += counts[(c * D + d) * RADIX_BUCKETS + k];
+        if (radix_trivial_digit(total, std::size_t(n))) continue;
+        // the counts of the first pass come from the histograms of all
+        // digits; after it the chunks hold other elements
+        if (!first_pass) {
+            std::fill(offsets.begin(), offsets.end(), std::size_t(0));
+            parallel_for(pool, std::size_t(0), chunks, [&](std::size_t c) {
+                if (in_buffer)
+                    radix_histogram(b + chunk_first(c), b + chunk_last(c), key, shift, &offsets[c * RADIX_BUCKETS]);
+                else
+                    radix_histogram(first + chunk_first(c), first + chunk_last(c), key, shift, &offsets[c * RADIX_BUCKETS]);
+            });
+        } else {
+            for (std::size_t c = 0; c < chunks; ++c)
+                std::copy(&counts[(c * D + d) * RADIX_BUCKETS], &counts[(c * D + d) * RADIX_BUCKETS] + RADIX_BUCKETS,
+                          &offsets[c * RADIX_BUCKETS]);
+            first_pass = false;
+        }
+        std::size_t sum = 0;
+        for (std::size_t k = 0; k < RADIX_BUCKETS; ++k) {
+            for (std::size_t c = 0; c < chunks; ++c) {
+                std::size_t count = offsets[c * RADIX_BUCKETS + k];
+                offsets[c * RADIX_BUCKETS + k] = sum;
+                sum += count;
+            }
+        }
+        parallel_for(pool, std::size_t(0), chunks, [&](std::size_t c) {
+            if (in_buffer)
+                radix_scatter(b + chunk_first(c), b + chunk_last(c), first, key, shift, &offsets[c * RADIX_BUCKETS]);
+            else
+                radix_scatter(first + chunk_first(c), first + chunk_last(c), b, key, shift, &offsets[c * RADIX_BUCKETS]);
+        });
+        in_buffer = !in_buffer;
+    }
+    if (in_buffer) std::move(b, b + n, first);
+}
+
+template <typename I>
+// requires: I is RandomAccessIterator with an integral or floating point value type
+inline
+void radix_sort_lsd_parallel(I first, I last, thread_pool& pool) {
+    typedef typename std::iterator_traits<I>::value_type T;
+    radix_sort_lsd_parallel(first, last, radix_key<T>{}, pool);
+}
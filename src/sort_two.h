@@ -1,10 +1,38 @@
 #pragma once
+#include <type_traits>
+#include <utility>
 
 template<typename T, typename Compare>
 // requires T is StrictWeakOrdering
-inline
+inline constexpr
+void sort_two(T& a, T& b, Compare cmp, std::false_type) {
+    // exchanges by moves rather than swap so that it can be evaluated at
+    // compile time; C++14 has no constexpr std::swap
+    if (cmp(b, a)) {
+        T tmp{ std::move(a) };
+        a = std::move(b);
+        b = std::move(tmp);
+    }
+}
+
+template<typename T, typename Compare>
+// requires T is StrictWeakOrdering and a scalar type
+inline constexpr
+void sort_two(T& a, T& b, Compare cmp, std::true_type) {
+    // both values are written back unconditionally, so the comparison
+    // selects rather than branches and compiles to conditional moves
+    bool c = cmp(b, a);
+    T x = a;
+    T y = b;
+    a = c ? y : x;
+    b = c ? x : y;
+}
+
+template<typename T, typename Compare>
+// requires T is StrictWeakOrdering
+inline constexpr
 void sort_two(T& a, T& b, Compare cmp) {
-    using std::swap;
-    if (cmp(b, a))
-        swap(a, b);        
-}
\ No newline at end of file
+    // GCC turns a select between structures back into branches, so only
+    // scalars take the branchless path
+    sort_two(a, b, cmp, typename std::is_scalar<T>::type{});
+}
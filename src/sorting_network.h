@@ -0,0 +1,150 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <utility>
+#include "sort_two.h"
+
+// A sorting network for a fixed n is a list of comparators (i, j), i < j,
+// each a sort_two of the elements at i and j. The lists are computed by
+// constexpr functions, and sort_n expands them into straight-line code
+
+struct comparator
+{
+    std::size_t i;
+    std::size_t j;
+};
+
+constexpr
+std::size_t ceil_log2(std::size_t n) {
+    std::size_t t = 0;
+    while ((std::size_t(1) << t) < n) ++t;
+    return t;
+}
+
+constexpr
+comparator merge_exchange_comparator(std::size_t n, std::size_t k) {
+    // the k-th comparator of Batcher's merge exchange sort of n elements
+    // (Knuth, Algorithm 5.2.2M), or {n, n} if there are fewer than k + 1.
+    // It works for any n; for n = 16 it has 63 comparators against the
+    // optimal 60
+    if (n < 2) return comparator{ n, n };
+    std::size_t t = ceil_log2(n);
+    for (std::size_t p = std::size_t(1) << (t - 1); p > 0; p >>= 1) {
+        std::size_t q = std::size_t(1) << (t - 1);
+        std::size_t r = 0;
+        std::size_t d = p;
+        while (true) {
+            for (std::size_t i = 0; i + d < n; ++i) {
+                if ((i & p) != r) continue;
+                if (k == 0) return comparator{ i, i + d };
+                --k;
+            }
+            if (q == p) break;
+            d = q - p;
+            q >>= 1;
+            r = p;
+        }
+    }
+    return comparator{ n, n };
+}
+
+constexpr
+std::size_t merge_exchange_size(std::size_t n) {
+    std::size_t k = 0;
+    while (merge_exchange_comparator(n, k).i != n) ++k;
+    return k;
+}
+
+constexpr
+comparator transposition_comparator(std::size_t n, std::size_t k) {
+    // the k-th comparator of odd-even transposition sort of n elements:
+    // n rounds, alternately comparing the even and the odd adjacent pairs
+    for (std::size_t round = 0; round < n; ++round) {
+        for (std::size_t i = round & 1; i + 1 < n; i += 2) {
+            if (k == 0) return comparator{ i, i + 1 };
+            --k;
+        }
+    }
+    return comparator{ n, n };
+}
+
+constexpr
+std::size_t transposition_size(std::size_t n) {
+    return n < 2 ? 0 : n * (n - 1) / 2;
+}
+
+template <std::size_t N, std::size_t K>
+struct merge_exchange_at
+{
+    // forces the comparator to be computed at compile time
+    static constexpr std::size_t i = merge_exchange_comparator(N, K).i;
+    static constexpr std::size_t j = merge_exchange_comparator(N, K).j;
+};
+
+template <std::size_t N, std::size_t K>
+struct transposition_at
+{
+    static constexpr std::size_t i = transposition_comparator(N, K).i;
+    static constexpr std::size_t j = transposition_comparator(N, K).j;
+};
+
+template <std::size_t N, typename I, typename Compare, std::size_t... K>
+// requires: I is RandomAccessIterator
+// requires: Compare is StrictWeakOrdering on the value type of I
+inline constexpr
+void sort_n(I first, Compare cmp, std::index_sequence<K...>) {
+    int unused[] = { 0, (sort_two(first[merge_exchange_at<N, K>::i],
+                                  first[merge_exchange_at<N, K>::j], cmp), 0)... };
+    (void)unused;
+    (void)first;
+    (void)cmp;
+}
+
+template <std::size_t N, typename I, typename Compare>
+// requires: I is RandomAccessIterator
+// requires: Compare is StrictWeakOrdering on the value type of I
+inline constexpr
+void sort_n(I first, Compare cmp) {
+    // sorts [first, first + N) with Batcher's network, unrolled; not stable
+    sort_n<N>(first, cmp, std::make_index_sequence<merge_exchange_size(N)>{});
+}
+
+template <std::size_t N, typename I>
+// requires: I is RandomAccessIterator with a TotallyOrdered value type
+inline constexpr
+void sort_n(I first) {
+    typedef typename std::iterator_traits<I>::value_type T;
+    sort_n<N>(first, std::less<T>{});
+}
+
+template <std::size_t N, typename I, typename Compare, std::size_t... K>
+// requires: I is RandomAccessIterator
+// requires: Compare is StrictWeakOrdering on the value type of I
+inline constexpr
+void stable_sort_n(I first, Compare cmp, std::index_sequence<K...>) {
+    int unused[] = { 0, (sort_two(first[transposition_at<N, K>::i],
+                                  first[transposition_at<N, K>::j], cmp), 0)... };
+    (void)unused;
+    (void)first;
+    (void)cmp;
+}
+
+template <std::size_t N, typename I, typename Compare>
+// requires: I is RandomAccessIterator
+// requires: Compare is StrictWeakOrdering on the value type of I
+inline constexpr
+void stable_sort_n(I first, Compare cmp) {
+    // sorts [first, first + N) with odd-even transposition, unrolled; it
+    // only exchanges neighbors that are out of order, so it is stable, at
+    // the price of N (N - 1) / 2 comparators
+    stable_sort_n<N>(first, cmp, std::make_index_sequence<transposition_size(N)>{});
+}
+
+template <std::size_t N, typename I>
+// requires: I is RandomAccessIterator with a TotallyOrdered value type
+inline constexpr
+void stable_sort_n(I first) {
+    typedef typename std::iterator_traits<I>::value_type T;
+    stable_sort_n<N>(first, std::less<T>{});
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <new>
+
+template <typename T>
+// requires alignof(T) <= alignof(std::max_align_t)
+class temporary_buffer
+{
+    // uninitialized storage for n objects of type T; the user constructs
+    // and destroys the objects, the buffer only owns the memory
+private:
+    T* p;
+    std::ptrdiff_t n;
+public:
+    explicit temporary_buffer(std::ptrdiff_t n) :
+        p{ n > 0 ? static_cast<T*>(::operator new(std::size_t(n) * sizeof(T))) : nullptr },
+        n{ n > 0 ? n : 0 } {}
+
+    ~temporary_buffer() { ::operator delete(p); }
+
+    temporary_buffer(const temporary_buffer&) = delete;
+    temporary_buffer& operator=(const temporary_buffer&) = delete;
+
+    T* begin() { return p; }
+    T* end() { return p + n; }
+    std::ptrdiff_t size() const { return n; }
+};
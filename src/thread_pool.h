@@ -0,0 +1,187 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class thread_pool
+{
+    // a fork-join pool: every thread owns a deque of tasks, pushes and pops
+    // at its back and, when it runs dry, steals from the front of the others;
+    // a thread waiting for a join keeps executing tasks instead of blocking.
+    // Tasks must not throw.
+private:
+    struct task
+    {
+        std::function<void()> f;
+        std::atomic<bool> done;
+        task(std::function<void()> f) : f{ std::move(f) }, done{ false } {}
+    };
+
+    struct queue
+    {
+        std::mutex mutex;
+        std::deque<task*> tasks;
+    };
+
+    std::vector<std::unique_ptr<queue>> queues;
+    std::vector<std::thread> threads;
+    std::atomic<bool> stopping;
+    std::atomic<std::size_t> pending;
+    std::atomic<std::size_t> next_external;
+    std::mutex sleep_mutex;
+    std::condition_variable sleep;
+
+    static const thread_pool*& owner() {
+        thread_local const thread_pool* p = nullptr;
+        return p;
+    }
+
+    static std::size_t& owner_index() {
+        thread_local std::size_t i = 0;
+        return i;
+    }
+
+    std::size_t self() const {
+        return owner() == this ? owner_index() : queues.size();
+    }
+
+    void push(std::size_t i, task* t) {
+        std::size_t before;
+        {
+            std::lock_guard<std::mutex> lock(queues[i]->mutex);
+            queues[i]->tasks.push_back(t);
+            before = pending++;
+        }
+        if (before == 0) {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            sleep.notify_all();
+        } else {
+            sleep.notify_one();
+        }
+    }
+
+    bool pop_back(std::size_t i, task* t) {
+        // removes t if it is still at the back of queue i
+        std::lock_guard<std::mutex> lock(queues[i]->mutex);
+        if (queues[i]->tasks.empty() || queues[i]->tasks.back() != t) return false;
+        queues[i]->tasks.pop_back();
+        --pending;
+        return true;
+    }
+
+    task* find(std::size_t i) {
+        // own queue from the back, the others from the front
+        std::size_t n = queues.size();
+        if (i < n) {
+            std::lock_guard<std::mutex> lock(queues[i]->mutex);
+            if (!queues[i]->tasks.empty()) {
+                task* t = queues[i]->tasks.back();
+                queues[i]->tasks.pop_back();
+                --pending;
+                return t;
+            }
+        }
+        for (std::size_t k = 1; k <= n; ++k) {
+            std::size_t j = (i + k) % n;
+            std::lock_guard<std::mutex> lock(queues[j]->mutex);
+            if (!queues[j]->tasks.empty()) {
+                task* t = queues[j]->tasks.front();
+                queues[j]->tasks.pop_front();
+                --pending;
+                return t;
+            }
+        }
+        return nullptr;
+    }
+
+    static void execute(task* t) {
+        t->f();
+        t->done.store(true, std::memory_order_release);
+    }
+
+    void work(std::size_t i) {
+        owner() = this;
+        owner_index() = i;
+        while (true) {
+            task* t = find(i);
+            if (t) {
+                execute(t);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            sleep.wait(lock, [this] { return stopping.load() || pending.load() != 0; });
+            if (stopping.load() && pending.load() == 0) return;
+        }
+    }
+
+public:
+    explicit thread_pool(std::size_t n = std::thread::hardware_concurrency()) :
+        stopping{ false },
+        pending{ 0 },
+        next_external{ 0 } {
+        if (n == 0) n = 1;
+        for (std::size_t i = 0; i < n; ++i)
+            queues.emplace_back(new queue);
+        for (std::size_t i = 0; i < n; ++i)
+            threads.emplace_back(&thread_pool::work, this, i);
+    }
+
+    ~thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stopping = true;
+        }
+        sleep.notify_all();
+        for (std::thread& t : threads) t.join();
+    }
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    std::size_t size() const {
+        return queues.size();
+    }
+
+    template <typename F, typename G>
+    // requires F and G are nullary function objects
+    void invoke(F f, G g) {
+        // runs f and g, possibly in parallel, and returns when both are done
+        std::size_t i = self();
+        std::size_t q = i < size() ? i : next_external++ % size();
+        task t{ std::function<void()>(std::move(g)) };
+        push(q, &t);
+        f();
+        if (pop_back(q, &t)) {
+            t.f();
+            return;
+        }
+        while (!t.done.load(std::memory_order_acquire)) {
+            task* other = find(i < size() ? i : q);
+            if (other)
+                execute(other);
+            else
+                std::this_thread::yield();
+        }
+    }
+};
+
+template <typename N, typename F>
+// requires: N is Integral
+// requires: F is a function object taking N
+void parallel_for(thread_pool& pool, N first, N last, F f) {
+    // calls f(i) for every i in [first, last), splitting the range in halves
+    if (first == last) return;
+    if (last - first == N(1)) {
+        f(first);
+        return;
+    }
+    N middle = first + ((last - first) >> 1);
+    pool.invoke([&] { parallel_for(pool, first, middle, f); },
+                [&] { parallel_for(pool, middle, last, f); });
+}